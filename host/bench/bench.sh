@@ -0,0 +1,72 @@
+#!/bin/sh
+# the benchmarks of the host build, run by `make bench`
+#  `bench/bench.sh`
+# the fixtures are made inside the build folder, then the scripts run there one at a time, in alphabetical order
+# (`decompress` reads what `compress` wrote), the report tells the time of each script and the throughput of the
+# ones which stream a single fixture
+# the times are measured on the host cpu, they are only comparable with each other (not with the ds)
+
+cd "$(dirname "$0")/.." || exit 2
+
+work=build/bench
+fixtures=$(pwd)/$work
+
+rm -rf "$work"
+mkdir -p "$work/tree" "$work/many" || exit 2
+cp bench/*.ns "$work/" || exit 2
+
+# a text corpus made of the sources, 8 MB for grep and 1 MB for the string builtins and the compressor
+: > "$work/text.txt"
+
+while [ "$(wc -c < "$work/text.txt")" -lt 8388608 ]; do
+  cat ../source/*.cpp ../source/*.h >> "$work/text.txt"
+done
+
+head -c 8388608 "$work/text.txt" > "$work/text8m.txt" && mv "$work/text8m.txt" "$work/text.txt"
+head -c 1048576 "$work/text.txt" > "$work/text1m.txt"
+
+# a 50 MB log for tail, hexdump and copy
+yes "a line of the log, long enough to be a realistic one [info] 0123456789" | head -c 52428800 > "$work/big.log"
+
+# 10k entries for the walker (100 folders of 99 files) and 5k files in one folder for the globs
+for folder in $(seq 100); do
+  mkdir "$work/tree/folder-$folder"
+  (cd "$work/tree/folder-$folder" && seq 99 | sed 's/^/file-/' | xargs touch)
+done
+
+(cd "$work/many" && seq 5000 | sed 's/^/entry-/; s/$/.txt/' | xargs touch && seq 500 | sed 's/^/entry-/; s/$/.log/' | xargs touch)
+
+# the values are never freed, so the big strings of the benchmarks are not reported as leaks
+leakLimit=1099511627776
+
+# a session with 1000 variables, saved by a setup script for `session.ns` to restore
+seq 1000 | sed "s/.*/variable& = 'the value of the variable number &'/" > "$work/session.setup"
+echo "save('session.nss')" >> "$work/session.setup"
+./nscript-runner -j 1 -l "$leakLimit" -o "$work/setup" "$work/session.setup" > /dev/null || exit 2
+
+./nscript-runner -j 1 -l "$leakLimit" -o "$work/results" "$work"/*.ns
+
+# the bytes streamed by each script, to compute its throughput
+throughputBytes()
+{
+  case "$1" in
+    grep-literal|grep-regex) wc -c < "$fixtures/text.txt" ;;
+    copy)                    wc -c < "$fixtures/big.log" ;;
+    compress|decompress)     wc -c < "$fixtures/text1m.txt" ;;
+    *)                       echo 0 ;;
+  esac
+}
+
+echo
+printf "%-14s %10s %10s  %s\n" "script" "ms" "MB/s" "status"
+
+tail -n +2 "$work/results/report.tsv" | while IFS="$(printf '\t')" read -r status microseconds prompts errors leaked script output; do
+  name=$(basename "$script" .ns)
+  bytes=$(throughputBytes "$name")
+  speed=$(awk -v b="$bytes" -v us="$microseconds" 'BEGIN { if (b > 0 && us > 0) printf "%.1f", b / us; else printf "-" }')
+
+  printf "%-14s %10.1f %10s  %s\n" "$name" "$(awk -v us="$microseconds" 'BEGIN { print us / 1000 }')" "$speed" "$status"
+done
+
+echo
+grep -h " -> " "$work/results/"*-compress.ns.out
\ No newline at end of file
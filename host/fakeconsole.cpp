@@ -0,0 +1,122 @@
+#include "fakeconsole.h"
+
+// the console attached to stdout, libnds keeps a single current console too
+static FakeConsole* attachedConsole = nullptr;
+
+void consoleClear()
+{
+  if (attachedConsole != nullptr)
+    attachedConsole->clear();
+}
+
+bool FakeConsole::attach()
+{
+  auto functions = cookie_io_functions_t();
+
+  functions.write = [] (void* cookie, const char* buffer, size_t size) -> ssize_t
+  {
+    ((FakeConsole*)cookie)->print(buffer, size);
+    return size;
+  };
+
+  auto file = fopencookie(this, "w", functions);
+
+  if (!file)
+    return false;
+
+  // the console reads the cursor right after printing, so nothing can be left in a buffer
+  setvbuf(file, nullptr, _IONBF, 0);
+
+  stdout          = file;
+  attachedConsole = this;
+  return true;
+}
+
+void FakeConsole::print(const char* text, uint64_t length)
+{
+  for (uint64_t i = 0; i < length; i++)
+    printChar(text[i]);
+}
+
+void FakeConsole::clear()
+{
+  for (int y = 0; y < printConsole.windowHeight; y++)
+    for (int x = 0; x < printConsole.windowWidth; x++)
+      map[x + printConsole.windowX + (y + printConsole.windowY) * printConsole.consoleWidth] = printConsole.fontCurPal | u16(' ');
+
+  printConsole.cursorX = 0;
+  printConsole.cursorY = 0;
+}
+
+std::string FakeConsole::getWindowText() const
+{
+  auto text = std::string();
+
+  for (int y = 0; y < printConsole.windowHeight; y++)
+  {
+    auto row = std::string();
+
+    for (int x = 0; x < printConsole.windowWidth; x++)
+      row.push_back(getChar(x, y));
+
+    row.erase(row.find_last_not_of(' ') + 1);
+    text += row + "\n";
+  }
+
+  return text;
+}
+
+void FakeConsole::printChar(char c)
+{
+  switch (c)
+  {
+    case '\n':
+      newRow();
+      printConsole.cursorX = 0;
+      return;
+
+    case '\r':
+      printConsole.cursorX = 0;
+      return;
+
+    case '\t':
+      for (auto spaces = printConsole.tabSize - printConsole.cursorX % printConsole.tabSize; spaces > 0; spaces--)
+        printChar(' ');
+
+      return;
+
+    case '\b':
+      if (printConsole.cursorX > 0)
+        printConsole.cursorX--;
+
+      return;
+  }
+
+  if (printConsole.cursorX >= printConsole.windowWidth)
+  {
+    newRow();
+    printConsole.cursorX = 0;
+  }
+
+  auto x = printConsole.cursorX++ + printConsole.windowX;
+  auto y = printConsole.cursorY + printConsole.windowY;
+
+  map[x + y * printConsole.consoleWidth] = printConsole.fontCurPal | u16(uint8_t(c) - printConsole.font.asciiOffset + printConsole.fontCharOffset);
+}
+
+void FakeConsole::newRow()
+{
+  if (++printConsole.cursorY < printConsole.windowHeight)
+    return;
+
+  // the last row is full, the whole window scrolls up by one row
+  printConsole.cursorY--;
+
+  for (int y = 0; y < printConsole.windowHeight; y++)
+    for (int x = 0; x < printConsole.windowWidth; x++)
+    {
+      auto& tile = map[x + printConsole.windowX + (y + printConsole.windowY) * printConsole.consoleWidth];
+
+      tile = y + 1 < printConsole.windowHeight ? map[x + printConsole.windowX + (y + 1 + printConsole.windowY) * printConsole.consoleWidth] : printConsole.fontCurPal | u16(' ');
+    }
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+// a libnds console drawing into a map in memory instead of the vram, so that the console runs headless on the host
+#include <nds.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+class FakeConsole
+{
+  private: PrintConsole     printConsole;
+  private: std::vector<u16> map; // the whole background map, the window is a part of it
+
+  public: FakeConsole(int width, int height)
+  {
+    this->printConsole = PrintConsole();
+    this->map          = std::vector<u16>(width * height);
+
+    // a plain ascii font starting at tile 0, so that each tile entry is the char itself
+    printConsole.font.asciiOffset = 0;
+    printConsole.font.numChars    = 256;
+    printConsole.fontBgMap        = map.data();
+    printConsole.consoleWidth     = width;
+    printConsole.consoleHeight    = height;
+    printConsole.windowWidth      = width;
+    printConsole.windowHeight     = height;
+    printConsole.tabSize          = 3;
+    printConsole.fontCharOffset   = 0;
+    printConsole.fontCurPal       = 0;
+
+    clear();
+  }
+
+  public: inline PrintConsole* getPrintConsole()
+  {
+    return &printConsole;
+  }
+
+  public: inline const std::vector<u16>& getMap() const
+  {
+    return map;
+  }
+
+  // the char drawn in a cell of the window
+  public: inline char getChar(int x, int y) const
+  {
+    return char(map[x + printConsole.windowX + (y + printConsole.windowY) * printConsole.consoleWidth] & 0xFF);
+  }
+
+  // replaces stdout with this console (like consoleInit does on the ds), returns false when it could not be opened
+  public: bool attach();
+
+  // draws the text the same way libnds does, wrapping at the end of the rows and scrolling at the bottom of the window
+  public: void print(const char* text, uint64_t length);
+
+  // clears the window and moves the cursor to its top left corner
+  public: void clear();
+
+  // the rows of the window without their trailing spaces
+  public: std::string getWindowText() const;
+
+  private: void printChar(char c);
+
+  private: void newRow();
+};
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+// the host filesystem is always mounted
+inline bool fatInitDefault()
+{
+  return true;
+}
\ No newline at end of file
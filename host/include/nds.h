@@ -0,0 +1,150 @@
+#pragma once
+
+// the few parts of libnds the interpreter core uses, so that it builds on the host (the runner never touches the ds hardware)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+typedef uint8_t           u8;
+typedef uint16_t          u16;
+typedef uint32_t          u32;
+typedef int32_t           s32;
+typedef volatile uint32_t vu32;
+typedef double            float64;
+
+// newlib's integer only printf family, glibc's one is used instead
+#define iprintf  printf
+#define fiprintf fprintf
+#define siprintf sprintf
+
+// the console of libnds, on the host it draws into a map in memory (see `fakeconsole.h`)
+typedef struct ConsoleFont
+{
+  u16* gfx;
+  u16* pal;
+  u16  numColors;
+  u8   bpp;
+  u16  asciiOffset;
+  u16  numChars;
+  bool convertSingleColor;
+} ConsoleFont;
+
+typedef bool (*ConsolePrint)(void* con, char c);
+
+typedef struct PrintConsole
+{
+  ConsoleFont  font;
+  u16*         fontBgMap;
+  u16*         fontBgGfx;
+  u8           mapBase;
+  u8           gfxBase;
+  u8           bgLayer;
+  int          bgId;
+  int          cursorX;
+  int          cursorY;
+  int          prevCursorX;
+  int          prevCursorY;
+  int          consoleWidth;
+  int          consoleHeight;
+  int          windowX;
+  int          windowY;
+  int          windowWidth;
+  int          windowHeight;
+  int          tabSize;
+  u16          fontCharOffset;
+  u16          fontCurPal;
+  ConsolePrint PrintChar;
+  bool         consoleInitialised;
+  bool         loadGraphics;
+} PrintConsole;
+
+// clears the attached fake console, it does nothing when there's none (the runner prints into files)
+void consoleClear();
+
+// the virtual keyboard and the buttons, their input only comes from the recordings on the host
+typedef struct Keyboard
+{
+  int offset_x;
+  int offset_y;
+  int grid_width;
+  int grid_height;
+  int state;
+  int shifted;
+  int visible;
+} Keyboard;
+
+#define NOKEY -1
+
+enum
+{
+  DVK_FOLD      = -23,
+  DVK_TAB       = 9,
+  DVK_BACKSPACE = 8,
+  DVK_CAPS      = -15,
+  DVK_SHIFT     = -14,
+  DVK_SPACE     = 32,
+  DVK_MENU      = -5,
+  DVK_ENTER     = 10,
+  DVK_CTRL      = -16,
+  DVK_UP        = -17,
+  DVK_RIGHT     = -18,
+  DVK_DOWN      = -19,
+  DVK_LEFT      = -20,
+  DVK_ALT       = -26,
+};
+
+enum
+{
+  KEY_A      = 1 << 0,
+  KEY_B      = 1 << 1,
+  KEY_SELECT = 1 << 2,
+  KEY_START  = 1 << 3,
+  KEY_RIGHT  = 1 << 4,
+  KEY_LEFT   = 1 << 5,
+  KEY_UP     = 1 << 6,
+  KEY_DOWN   = 1 << 7,
+  KEY_R      = 1 << 8,
+  KEY_L      = 1 << 9,
+  KEY_X      = 1 << 10,
+  KEY_Y      = 1 << 11,
+  KEY_TOUCH  = 1 << 12,
+  KEY_LID    = 1 << 13,
+};
+
+inline void keyboardShow()
+{
+}
+
+// the frames are not paced on the host
+inline void swiWaitForVBlank()
+{
+}
+
+// the cpu timing of libnds, emulated with the monotonic clock counting at the ds bus clock,
+// starting the timing resets the count as the ds timers do
+#define BUS_CLOCK 33513982
+
+inline uint64_t monotonicBusTicks()
+{
+  timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec) * BUS_CLOCK + uint64_t(now.tv_nsec) * BUS_CLOCK / 1000000000;
+}
+
+inline uint64_t cpuTimingOrigin = 0;
+
+inline void cpuStartTiming(int timer)
+{
+  cpuTimingOrigin = monotonicBusTicks();
+}
+
+inline u32 cpuGetTiming()
+{
+  return u32(monotonicBusTicks() - cpuTimingOrigin);
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+#pragma once
+
+// libnds declares the console in its own header, the host one declares it along with the rest
+#include <nds.h>
\ No newline at end of file
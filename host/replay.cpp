@@ -0,0 +1,295 @@
+// the replay harness of the host build: it runs the console headless on a fake screen, fed by a recording made with `record()`
+//  `nscript-replay [-g golden] [-u] recording`
+// it reports the boot phases (up to the first prompt), how many frames the typed chars take to be drawn and the cpu time
+// of each part of the frames,
+// then compares the final screen with the golden file (`-u` writes the screen into it instead)
+
+#include <nds.h>
+#include <c++/12.1.0/string>
+#include <c++/12.1.0/vector>
+#include <fstream>
+#include <sstream>
+
+#include "basics.h"
+#include "console.h"
+#include "input.h"
+#include "fakeconsole.h"
+
+// the top screen in tiles
+const int screenColumns = 32;
+const int screenRows    = 24;
+
+// idle frames replayed after the recording, so that the last prompt is completely parsed and drawn
+const uint64_t settlingFrames = 64;
+
+class TimingStats
+{
+  public: uint64_t totalTicks;
+  public: u32      maxTicks;
+  public: uint64_t maxFrame;   // the frame which took maxTicks
+  public: uint64_t framesCount;
+
+  public: void add(u32 ticks, uint64_t frame)
+  {
+    totalTicks += ticks;
+    framesCount++;
+
+    if (ticks > maxTicks)
+    {
+      maxTicks = ticks;
+      maxFrame = frame;
+    }
+  }
+};
+
+// a char typed on the virtual keyboard which is not drawn yet
+class PendingGlyph
+{
+  public: char     c;
+  public: uint64_t frame;
+};
+
+class Replay
+{
+  private: FakeConsole&              screen;
+  private: NDSConsole&               console;
+  private: std::vector<PendingGlyph> pendingGlyphs;
+  private: std::vector<u16>          previousMap;
+
+  public: TimingStats           inputStats;
+  public: TimingStats           parseStats;
+  public: TimingStats           flushStats;
+  public: std::vector<uint64_t> latencies;   // for each drawn glyph, the frames from its key press to the frame which drew it
+  public: uint64_t              framesCount;
+
+  public: Replay(FakeConsole& screen, NDSConsole& console) : screen(screen), console(console)
+  {
+    this->pendingGlyphs = std::vector<PendingGlyph>();
+    this->previousMap   = std::vector<u16>();
+    this->inputStats    = TimingStats();
+    this->parseStats    = TimingStats();
+    this->flushStats    = TimingStats();
+    this->latencies     = std::vector<uint64_t>();
+    this->framesCount   = 0;
+  }
+
+  public: inline uint64_t getUndrawnGlyphsCount() const
+  {
+    return pendingGlyphs.size();
+  }
+
+  // runs the frames the same way the main loop of the ds does, the recorded input takes the place of the hardware one
+  public: void run(const std::vector<NScript::InputFrame>& frames)
+  {
+    for (const auto& input : frames)
+      runFrame(input);
+
+    for (uint64_t i = 0; i < settlingFrames; i++)
+      runFrame((NScript::InputFrame) { .keyboardKey = NOKEY, .buttonKeys = 0 });
+  }
+
+  private: void runFrame(const NScript::InputFrame& input)
+  {
+    auto timing = FrameTiming();
+    auto frame  = framesCount++;
+
+    previousMap = screen.getMap();
+
+    // a space may be drawn over a blank cell, so only the visible chars are tracked
+    if (input.keyboardKey > ' ' && input.keyboardKey < 127)
+      pendingGlyphs.push_back((PendingGlyph) { .c = char(input.keyboardKey), .frame = frame });
+
+    console.updateFrame(frame, input, timing);
+
+    inputStats.add(timing.inputTicks, frame);
+    parseStats.add(timing.parseTicks, frame);
+    flushStats.add(timing.flushTicks, frame);
+
+    collectDrawnGlyphs(frame);
+  }
+
+  // the typed chars are drawn into the cells which changed in this frame, the oldest pending one matching a cell is taken
+  private: void collectDrawnGlyphs(uint64_t frame)
+  {
+    const auto& map = screen.getMap();
+
+    for (uint64_t i = 0; i < map.size() && !pendingGlyphs.empty(); i++)
+    {
+      if (map[i] == previousMap[i])
+        continue;
+
+      for (uint64_t j = 0; j < pendingGlyphs.size(); j++)
+        if (pendingGlyphs[j].c == char(map[i] & 0xFF))
+        {
+          latencies.push_back(frame - pendingGlyphs[j].frame);
+          pendingGlyphs.erase(pendingGlyphs.begin() + j);
+          break;
+        }
+    }
+  }
+};
+
+static inline unsigned long ticksToMicroseconds(uint64_t ticks)
+{
+  return (unsigned long)(ticks * 1000000 / BUS_CLOCK);
+}
+
+static void printTimingStats(FILE* output, cstring_t name, const TimingStats& stats)
+{
+  // most frames take less than a microsecond on the host, the average keeps the fractions
+  fprintf(
+    output, "%-8s avg %.2f us, max %lu us (frame %lu)\n",
+    name, double(stats.totalTicks) * 1000000 / BUS_CLOCK / std::max(uint64_t(1), stats.framesCount),
+    ticksToMicroseconds(stats.maxTicks), (unsigned long)stats.maxFrame
+  );
+}
+
+static void printLatencies(FILE* output, const Replay& replay)
+{
+  uint64_t total = 0;
+  uint64_t worst = 0;
+
+  for (const auto& latency : replay.latencies)
+  {
+    total += latency;
+    worst  = std::max(worst, latency);
+  }
+
+  // 0 frames means the glyph is drawn before the vblank which ends the frame of its key press
+  fprintf(
+    output, "latency  %lu glyphs, avg %.2f frames, max %lu frames, %lu never drawn\n",
+    (unsigned long)replay.latencies.size(), replay.latencies.empty() ? 0.0 : double(total) / replay.latencies.size(),
+    (unsigned long)worst, (unsigned long)replay.getUndrawnGlyphsCount()
+  );
+}
+
+// returns false when the screen differs from the golden one, the first different row is printed
+static bool compareWithGolden(FILE* output, const std::string& path, const std::string& screenText)
+{
+  auto file = std::ifstream(path);
+
+  if (!file.is_open())
+  {
+    fprintf(output, "screen   unable to open golden `%s`\n", path.c_str());
+    return false;
+  }
+
+  auto golden = std::stringstream();
+
+  golden << file.rdbuf();
+
+  if (golden.str() == screenText)
+  {
+    fprintf(output, "screen   matches `%s`\n", path.c_str());
+    return true;
+  }
+
+  auto expected = std::istringstream(golden.str());
+  auto actual   = std::istringstream(screenText);
+
+  for (uint64_t row = 0; true; row++)
+  {
+    auto expectedRow = std::string();
+    auto actualRow   = std::string();
+    auto hasExpected = bool(std::getline(expected, expectedRow));
+    auto hasActual   = bool(std::getline(actual, actualRow));
+
+    if (hasExpected != hasActual || expectedRow != actualRow)
+    {
+      fprintf(output, "screen   differs from `%s` at row %lu\n  expected `%s`\n  actual   `%s`\n", path.c_str(), (unsigned long)row, expectedRow.c_str(), actualRow.c_str());
+      return false;
+    }
+  }
+}
+
+static bool writeGolden(FILE* output, const std::string& path, const std::string& screenText)
+{
+  auto file = fopen(path.c_str(), "w");
+
+  if (!file || fwrite(screenText.data(), 1, screenText.length(), file) != screenText.length() || fclose(file))
+  {
+    fprintf(output, "screen   unable to write golden `%s`\n", path.c_str());
+    return false;
+  }
+
+  fprintf(output, "screen   written into `%s`\n", path.c_str());
+  return true;
+}
+
+static void printUsage()
+{
+  fprintf(stderr, "usage: nscript-replay [-g golden] [-u] recording\n");
+}
+
+int main(int argc, char** argv)
+{
+  auto goldenPath    = std::string();
+  auto recordingPath = std::string();
+  auto shouldUpdate  = false;
+  auto frames        = std::vector<NScript::InputFrame>();
+
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-g") && i + 1 < argc)
+      goldenPath = argv[++i];
+    else if (!strcmp(argv[i], "-u"))
+      shouldUpdate = true;
+    else
+      recordingPath = argv[i];
+
+  if (recordingPath.empty() || (shouldUpdate && goldenPath.empty()))
+  {
+    printUsage();
+    return 2;
+  }
+
+  if (!NScript::InputLog::readRecording(recordingPath, frames))
+  {
+    fprintf(stderr, "unable to read the recording `%s`\n", recordingPath.c_str());
+    return 2;
+  }
+
+  // the report is printed on the real stdout, the one of the console draws on the fake screen
+  auto     output   = stdout;
+  auto     screen   = FakeConsole(screenColumns, screenRows);
+  Keyboard keyboard = Keyboard();
+
+  // the boot is timed as in main.cpp, the fake screen stands in for the video, the vram, the console and the keyboard
+  startBootTiming();
+
+  if (!screen.attach())
+  {
+    fprintf(stderr, "unable to attach the fake console\n");
+    return 2;
+  }
+
+  markBootPhase("console");
+
+  // the same boot screen of main.cpp
+  NDSConsole console(screen.getPrintConsole(), &keyboard);
+
+  iprintf("Nintendo DS Console ARM9\n");
+  console.printPromptPrefix();
+  markBootPhase("prompt");
+
+  // main.cpp mounts once the first prompt is on screen
+  mountFilesystem();
+
+  auto replay = Replay(screen, console);
+
+  replay.run(frames);
+
+  printBootReport(output);
+  fprintf(output, "replayed %lu frames (+%lu settling)\n", (unsigned long)frames.size(), (unsigned long)settlingFrames);
+  printLatencies(output, replay);
+  printTimingStats(output, "input", replay.inputStats);
+  printTimingStats(output, "parse", replay.parseStats);
+  printTimingStats(output, "flush", replay.flushStats);
+
+  if (goldenPath.empty())
+    return 0;
+
+  auto screenText = screen.getWindowText();
+  auto isPassed   = shouldUpdate ? writeGolden(output, goldenPath, screenText) : compareWithGolden(output, goldenPath, screenText);
+
+  return isPassed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,399 @@
+// the headless runner of the host build: it evaluates nscript files in parallel, outside the ds
+//  `nscript-runner [-j workers] [-o folder] [-l bytes] paths...`
+// every line of a script is evaluated as a prompt of the console, the folders are searched for `.ns` scripts,
+// the output of each script goes to its own file, the timing of all of them to `report.tsv` and the memory left allocated
+// by each worker to `memory.txt`
+
+#include <nds.h>
+#include <c++/12.1.0/string>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/algorithm>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <fstream>
+#include <limits.h>
+#include <errno.h>
+
+#include "basics.h"
+#include "nscript.h"
+#include "walker.h"
+
+const cstring_t scriptExtension     = ".ns";
+const cstring_t defaultOutputFolder = "nscript-results";
+
+// the bytes a script can leave allocated once its session is over (the values are never freed, so some are expected),
+// the scripts leaking more make the runner fail
+const uint64_t defaultLeakLimit = 16 * 1024;
+
+class ScriptReport
+{
+  public: std::string path;
+  public: std::string outputPath;
+  public: uint64_t    promptsCount;
+  public: uint64_t    failedPromptsCount;
+  public: uint64_t    microseconds;
+  public: uint64_t    leakedBytes;      // still allocated once the session of the script is over
+  public: bool        isOpened;         // false when the script or its output file could not be opened
+};
+
+// the scripts left to a worker, the owner takes them from the front and the idle workers steal them from the back
+class WorkQueue
+{
+  private: std::deque<uint64_t> scripts;
+  private: std::mutex           mutex;
+
+  public: void push(uint64_t script)
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+
+    scripts.push_back(script);
+  }
+
+  // returns false when the queue is empty
+  public: bool pop(uint64_t& script)
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+
+    if (scripts.empty())
+      return false;
+
+    script = scripts.front();
+    scripts.pop_front();
+    return true;
+  }
+
+  public: bool steal(uint64_t& script)
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+
+    if (scripts.empty())
+      return false;
+
+    script = scripts.back();
+    scripts.pop_back();
+    return true;
+  }
+};
+
+class Runner
+{
+  private: std::vector<WorkQueue>         queues;   // one for each worker
+  private: std::vector<ScriptReport>      reports;  // one for each script, each is only written by the worker which ran it
+  private: std::vector<AllocationCounter> counters; // the allocation accounting of each worker, taken when it's done
+
+  public: Runner(const std::vector<std::string>& scripts, const std::string& outputFolder, uint64_t workersCount)
+  {
+    this->queues   = std::vector<WorkQueue>(workersCount);
+    this->reports  = std::vector<ScriptReport>(scripts.size());
+    this->counters = std::vector<AllocationCounter>(workersCount);
+
+    for (uint64_t i = 0; i < scripts.size(); i++)
+    {
+      reports[i].path       = scripts[i];
+      reports[i].outputPath = outputFolder + "/" + std::to_string(i) + "-" + getPathName(scripts[i]) + ".out";
+
+      // neighbour scripts often have a similar cost, so they are dealt like cards
+      queues[i % workersCount].push(i);
+    }
+  }
+
+  public: inline const std::vector<ScriptReport>& getReports()
+  {
+    return reports;
+  }
+
+  public: inline const std::vector<AllocationCounter>& getCounters()
+  {
+    return counters;
+  }
+
+  // runs all the scripts, returns once all of them are done
+  public: void run()
+  {
+    auto workers = std::vector<std::thread>();
+
+    for (uint64_t i = 0; i < queues.size(); i++)
+      workers.push_back(std::thread([this, i] { work(i); }));
+
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  private: void work(uint64_t workerIndex)
+  {
+    uint64_t script = 0;
+
+    while (nextScript(workerIndex, script))
+      runScript(reports[script]);
+
+    counters[workerIndex] = allocationCounter;
+  }
+
+  // takes a script from the worker's queue, or steals one from the others when it's empty
+  private: bool nextScript(uint64_t workerIndex, uint64_t& script)
+  {
+    if (queues[workerIndex].pop(script))
+      return true;
+
+    // no script is queued while running, so when all the queues are empty the work is over
+    for (uint64_t i = 1; i < queues.size(); i++)
+      if (queues[(workerIndex + i) % queues.size()].steal(script))
+        return true;
+
+    return false;
+  }
+
+  private: void runScript(ScriptReport& report)
+  {
+    auto startTime = std::chrono::steady_clock::now();
+    auto source    = std::ifstream(report.path);
+    auto output    = fopen(report.outputPath.c_str(), "w");
+
+    report.promptsCount       = 0;
+    report.failedPromptsCount = 0;
+    report.leakedBytes        = 0;
+    report.isOpened           = source.is_open() && output;
+
+    if (report.isOpened)
+    {
+      // the accounting is per thread, so it only sees the allocations of this script
+      auto liveBytes = allocationCounter.totalLiveBytes;
+
+      runSession(source, output, report);
+      report.leakedBytes = allocationCounter.totalLiveBytes - liveBytes;
+    }
+
+    if (output)
+      fclose(output);
+
+    report.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+  }
+
+  private: void runSession(std::ifstream& source, FILE* output, ScriptReport& report)
+  {
+    // each script starts from a clean session inside its own folder, isolated from the other workers,
+    // its lazy files are closed when it's over
+    auto evaluator = NScript::Evaluator();
+
+    evaluator.output       = output;
+    evaluator.cwd          = getScriptFolder(report.path);
+
+    // the values of the previous scripts are never freed, the budget only counts the new ones
+    evaluator.memoryBudget = allocationCounter.totalLiveBytes + NScript::defaultMemoryBudget;
+
+    for (std::string prompt; std::getline(source, prompt);)
+      if (!prompt.empty())
+        runPrompt(evaluator, prompt, output, report);
+  }
+
+  // prints the prompt, what it printed and its result (or its error), the same way the console does
+  private: void runPrompt(NScript::Evaluator& evaluator, const std::string& prompt, FILE* output, ScriptReport& report)
+  {
+    auto parser = NScript::Parser(prompt);
+    auto tree   = parser.parse();
+    auto error  = parser.error;
+
+    report.promptsCount++;
+    fprintf(output, "$ %s\n", prompt.c_str());
+
+    if (!parser.failed())
+    {
+      evaluator.clearError();
+
+      auto result = evaluator.evaluateNode(tree);
+
+      error = evaluator.error;
+
+      if (!evaluator.failed() && result.kind != NScript::NodeKind::None)
+      {
+        evaluator.printResult(result);
+        fprintf(output, "\n");
+      }
+    }
+
+    if (parser.failed() || evaluator.failed())
+    {
+      fprintf(output, "error: ");
+
+      for (const auto& m : error.message)
+        fprintf(output, "%s", m.c_str());
+
+      fprintf(output, " (at %u..%u)\n", error.position.startPos, error.position.endPos);
+      report.failedPromptsCount++;
+    }
+
+    // the strings of the tree may be referenced by the variables, they are not freed
+    NScript::Parser::deleteTree(tree);
+  }
+
+  private: static std::string getScriptFolder(const std::string& path)
+  {
+    char fullPath[PATH_MAX];
+
+    if (!realpath(path.c_str(), fullPath))
+      return "/";
+
+    return addTrailingSlashToPath(std::string(fullPath).substr(0, std::string(fullPath).rfind('/')));
+  }
+};
+
+static bool hasScriptExtension(const std::string& path)
+{
+  auto extensionLength = strlen(scriptExtension);
+
+  return path.length() > extensionLength && !path.compare(path.length() - extensionLength, extensionLength, scriptExtension);
+}
+
+// the folders are searched recursively, the scripts are sorted so that the reports are stable
+static bool collectScripts(const std::vector<std::string>& paths, std::vector<std::string>& scripts)
+{
+  for (const auto& path : paths)
+  {
+    struct stat info;
+
+    if (stat(path.c_str(), &info))
+    {
+      fprintf(stderr, "unable to find `%s`\n", path.c_str());
+      return false;
+    }
+
+    if (!S_ISDIR(info.st_mode))
+    {
+      scripts.push_back(path);
+      continue;
+    }
+
+    auto walker = NScript::DirWalker(addTrailingSlashToPath(path).c_str());
+
+    while (walker.next())
+      if (walker.event == NScript::WalkEvent::File && hasScriptExtension(walker.getPath()))
+        scripts.push_back(walker.getPath());
+      else if (walker.event == NScript::WalkEvent::Error)
+        fprintf(stderr, "unable to visit `%s`\n", walker.getPath());
+  }
+
+  std::sort(scripts.begin(), scripts.end());
+  return true;
+}
+
+static cstring_t getStatus(const ScriptReport& report, uint64_t leakLimit)
+{
+  if (!report.isOpened)
+    return "unopened";
+
+  if (report.failedPromptsCount > 0)
+    return "failed";
+
+  return report.leakedBytes > leakLimit ? "leaked" : "ok";
+}
+
+static bool writeReport(const std::string& path, const std::vector<ScriptReport>& reports, uint64_t leakLimit)
+{
+  auto file = fopen(path.c_str(), "w");
+
+  if (!file)
+    return false;
+
+  fprintf(file, "status\tmicroseconds\tprompts\terrors\tleaked\tscript\toutput\n");
+
+  for (const auto& r : reports)
+    fprintf(
+      file, "%s\t%lu\t%lu\t%lu\t%lu\t%s\t%s\n",
+      getStatus(r, leakLimit), (unsigned long)r.microseconds, (unsigned long)r.promptsCount, (unsigned long)r.failedPromptsCount,
+      (unsigned long)r.leakedBytes, r.path.c_str(), r.outputPath.c_str()
+    );
+
+  return !fclose(file);
+}
+
+// the same report of `mem()`, for each worker once all its scripts are done
+static bool writeMemoryReport(const std::string& path, const std::vector<AllocationCounter>& counters)
+{
+  auto file = fopen(path.c_str(), "w");
+
+  if (!file)
+    return false;
+
+  for (uint64_t i = 0; i < counters.size(); i++)
+  {
+    fprintf(file, "worker %lu\n", (unsigned long)i);
+    printAllocationReport(file, counters[i]);
+  }
+
+  return !fclose(file);
+}
+
+static void printUsage()
+{
+  fprintf(stderr, "usage: nscript-runner [-j workers] [-o folder] [-l bytes] paths...\n");
+}
+
+int main(int argc, char** argv)
+{
+  uint64_t workersCount = std::max(1u, std::thread::hardware_concurrency());
+  auto     outputFolder = std::string(defaultOutputFolder);
+  uint64_t leakLimit    = defaultLeakLimit;
+  auto     paths        = std::vector<std::string>();
+  auto     scripts      = std::vector<std::string>();
+
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      workersCount = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      outputFolder = argv[++i];
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+      leakLimit = strtoull(argv[++i], nullptr, 10);
+    else
+      paths.push_back(argv[i]);
+
+  if (paths.empty())
+  {
+    printUsage();
+    return 2;
+  }
+
+  if (!collectScripts(paths, scripts))
+    return 2;
+
+  if (mkdir(outputFolder.c_str(), 0777) && errno != EEXIST)
+  {
+    fprintf(stderr, "unable to make folder `%s`\n", outputFolder.c_str());
+    return 2;
+  }
+
+  // mounted before the workers start, so that the mount is not timed as a part of the first scripts
+  mountFilesystem();
+
+  auto startTime = std::chrono::steady_clock::now();
+  auto runner    = Runner(scripts, outputFolder, std::min(workersCount, std::max(uint64_t(1), uint64_t(scripts.size()))));
+
+  runner.run();
+
+  auto     milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+  uint64_t failures     = 0;
+  uint64_t leaks        = 0;
+  uint64_t microseconds = 0;
+
+  for (const auto& r : runner.getReports())
+  {
+    failures     += !r.isOpened || r.failedPromptsCount > 0;
+    leaks        += r.isOpened && r.leakedBytes > leakLimit;
+    microseconds += r.microseconds;
+  }
+
+  if (!writeReport(outputFolder + "/report.tsv", runner.getReports(), leakLimit))
+    fprintf(stderr, "unable to write `%s/report.tsv`\n", outputFolder.c_str());
+
+  if (!writeMemoryReport(outputFolder + "/memory.txt", runner.getCounters()))
+    fprintf(stderr, "unable to write `%s/memory.txt`\n", outputFolder.c_str());
+
+  printf(
+    "%lu scripts, %lu with errors, %lu leaking over %lu B, %lu ms (%lu ms of scripts on %lu workers)\n",
+    (unsigned long)scripts.size(), (unsigned long)failures, (unsigned long)leaks, (unsigned long)leakLimit,
+    (unsigned long)milliseconds, (unsigned long)(microseconds / 1000), (unsigned long)std::min(workersCount, uint64_t(scripts.size()))
+  );
+
+  return failures + leaks > 0 ? 1 : 0;
+}
\ No newline at end of file
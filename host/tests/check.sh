@@ -0,0 +1,75 @@
+#!/bin/sh
+# the regression tests of the host build, run by `make check`
+#  `tests/check.sh [-u]`
+# the output of each script in `scripts` and the final screen of each recording in `replay` are compared with their
+# `.golden` files (`-u` writes them into the golden files instead), the scripts also fail when they leak,
+# then the programs of `units` are run
+# the scripts run on a copy of the corpus inside the build folder, so that the files they make are thrown away
+
+cd "$(dirname "$0")/.." || exit 2
+
+work=build/check
+leakLimit=16384
+update=""
+failures=0
+
+[ "$1" = "-u" ] && update="-u"
+
+rm -rf "$work"
+mkdir -p "$work/scripts" || exit 2
+cp tests/scripts/*.ns "$work/scripts/" || exit 2
+
+# the errors of the scripts are part of their golden files, so the exit code of the runner is not used
+./nscript-runner -l "$leakLimit" -o "$work/results" "$work/scripts" > /dev/null
+
+# the errors print full paths, they are made relative to the corpus folder
+scriptsFolder="$(cd "$work/scripts" && pwd)/"
+index=0
+
+for script in $(LC_ALL=C ls tests/scripts/*.ns); do
+  name=$(basename "$script" .ns)
+  output="$work/results/$index-$name.ns.out"
+  golden="tests/scripts/$name.golden"
+  index=$((index + 1))
+
+  sed "s|$scriptsFolder||g" "$output" > "$output.relative"
+
+  if [ -n "$update" ]; then
+    cp "$output.relative" "$golden"
+  elif ! diff -u "$golden" "$output.relative"; then
+    echo "FAIL $script"
+    failures=$((failures + 1))
+  fi
+done
+
+# the status of the scripts with errors is `failed`, so the leaks are taken from their own column
+leaking=$(awk -F '\t' -v limit="$leakLimit" 'NR > 1 && ($1 == "unopened" || $5 > limit) { print $6 }' "$work/results/report.tsv")
+
+for script in $leaking; do
+  echo "FAIL $script (unopened or leaking over $leakLimit B)"
+  failures=$((failures + 1))
+done
+
+for recording in $(LC_ALL=C ls tests/replay/*.nsi); do
+  if ! ./nscript-replay -g "${recording%.nsi}.golden" $update "$recording" > "$work/$(basename "$recording").txt"; then
+    cat "$work/$(basename "$recording").txt"
+    echo "FAIL $recording"
+    failures=$((failures + 1))
+  fi
+done
+
+# the unit checks print what failed
+for unit in $(LC_ALL=C ls tests/units/*.cpp); do
+  if ! "build/units/$(basename "$unit" .cpp)"; then
+    echo "FAIL $unit"
+    failures=$((failures + 1))
+  fi
+done
+
+if [ -n "$update" ]; then
+  echo "golden files written"
+  exit 0
+fi
+
+echo "$failures failures"
+[ "$failures" -eq 0 ]
\ No newline at end of file
@@ -0,0 +1,63 @@
+// checks that evaluating arithmetic on numbers allocates nothing, the nodes are evaluated by reference
+//  `build/units/allocations`, run by `make check`
+
+#include <nds.h>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+#include "nscript.h"
+
+// returns false when the expression failed or allocated while it was evaluated (its parsing is not counted)
+static bool checkNoAllocations(NScript::Evaluator& evaluator, const std::string& expression)
+{
+  auto parser = NScript::Parser(expression);
+  auto tree   = parser.parse();
+
+  if (parser.failed())
+  {
+    printf("FAIL `%s` could not be parsed\n", expression.c_str());
+    return false;
+  }
+
+  evaluator.clearError();
+
+  auto allocatedBytes = allocationCounter.allocatedBytes;
+  auto result         = evaluator.evaluateNode(tree);
+  auto allocated      = allocationCounter.allocatedBytes - allocatedBytes;
+
+  NScript::Parser::deleteTree(tree);
+
+  if (evaluator.failed() || result.kind != NScript::NodeKind::Num)
+  {
+    printf("FAIL `%s` did not evaluate to a number\n", expression.c_str());
+    return false;
+  }
+
+  if (allocated > 0)
+  {
+    printf("FAIL `%s` allocated %lu B\n", expression.c_str(), (unsigned long)allocated);
+    return false;
+  }
+
+  return true;
+}
+
+int main()
+{
+  auto     evaluator = NScript::Evaluator();
+  uint64_t failures  = 0;
+
+  evaluator.output = stdout;
+
+  // the variable is declared first, declaring it allocates its slot
+  auto parser = NScript::Parser("x = 5");
+  auto assign = parser.parse();
+
+  evaluator.evaluateNode(assign);
+  NScript::Parser::deleteTree(assign);
+
+  for (const auto& expression : { "1+2*3", "(1 + 2) * 3 / 4", "-(8 - 2.5) * -x", "x * x + x / 2" })
+    failures += !checkNoAllocations(evaluator, expression);
+
+  return failures > 0 ? 1 : 0;
+}
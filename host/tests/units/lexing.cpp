@@ -0,0 +1,143 @@
+// checks that a prompt parsed incrementally, the way the console does while it's typed, gives the same result as a fresh parse
+//  `build/units/lexing`, run by `make check`
+// random edits are made to random prompts, with some tokens lexed between them, then the tokens, the tree and the error of the
+// live parser are compared with the ones of a parser which sees the whole prompt at once
+
+#include <nds.h>
+#include <c++/12.1.0/string>
+#include <c++/12.1.0/vector>
+
+#include "basics.h"
+#include "nscript.h"
+
+const uint64_t sessionsCount    = 100;
+const uint64_t editsPerSession  = 900;
+const uint64_t maxPromptLength  = 48;
+
+// the pieces the prompts are made of, some are only a part of a token (and some make lexing errors)
+const cstring_t pieces[] = {
+  "a", "b", "name", "x1", "1", "2", "42", ".", "0x", "f", "0b", " ", " ", "+", "-", "*", "/", "(", ")", "=", ",", "|",
+  "'", "'", "\\", "\\n", "\\0", "def ", "len(", "upper(", "#", "?",
+};
+
+// xorshift, so that the edits are the same on every run
+class Random
+{
+  private: uint64_t state;
+
+  public: Random(uint64_t seed)
+  {
+    this->state = seed;
+  }
+
+  public: uint64_t next(uint64_t bound)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return state % bound;
+  }
+};
+
+class ParseResult
+{
+  public: std::string tokens;
+  public: std::string tree;
+  public: std::string error;
+};
+
+static std::string errorToString(const NScript::Error& error)
+{
+  std::string s;
+
+  for (const auto& m : error.message)
+    s += m;
+
+  return s + " (at " + std::to_string(error.position.startPos) + ".." + std::to_string(error.position.endPos) + ")";
+}
+
+static ParseResult parse(NScript::Parser& parser)
+{
+  auto result = ParseResult();
+  auto tree   = parser.parse();
+
+  for (const auto& token : parser.getTokens())
+    result.tokens += NScript::Node::kindToString(token.kind) + "@" + std::to_string(token.pos.startPos) + ".." + std::to_string(token.pos.endPos) + " ";
+
+  if (parser.failed())
+    result.error = errorToString(parser.error);
+  else
+  {
+    result.tree = tree.toString();
+    NScript::Parser::deleteTree(tree);
+  }
+
+  return result;
+}
+
+// returns false when some edit made the live parser differ from a fresh one
+static bool checkSession(Random& random, uint64_t session)
+{
+  auto prompt = std::string();
+  auto live   = NScript::Parser(prompt);
+
+  for (uint64_t edit = 0; edit < editsPerSession; edit++)
+  {
+    uint64_t editedIndex = random.next(prompt.length() + 1);
+
+    // typing a piece, deleting some chars or replacing the whole prompt (as recalling the history does)
+    switch (random.next(8))
+    {
+      case 0:
+        if (!prompt.empty())
+          prompt.erase(editedIndex, 1 + random.next(3));
+
+        break;
+
+      case 1:
+        prompt      = std::string();
+        editedIndex = 0;
+        break;
+
+      default:
+        if (prompt.length() < maxPromptLength)
+          prompt.insert(editedIndex, pieces[random.next(sizeof(pieces) / sizeof(pieces[0]))]);
+
+        break;
+    }
+
+    live.edit(prompt, editedIndex);
+
+    // the console lexes a few tokens each frame, and may parse only after some more edits
+    live.lex(random.next(4));
+
+    if (random.next(3))
+      continue;
+
+    auto fresh          = NScript::Parser(prompt);
+    auto liveResult     = parse(live);
+    auto expectedResult = parse(fresh);
+
+    if (liveResult.tokens != expectedResult.tokens || liveResult.tree != expectedResult.tree || liveResult.error != expectedResult.error)
+    {
+      printf("FAIL session %lu, edit %lu, `%s`\n", (unsigned long)session, (unsigned long)edit, prompt.c_str());
+      printf("  live:  %s| %s%s\n", liveResult.tokens.c_str(), liveResult.tree.c_str(), liveResult.error.c_str());
+      printf("  fresh: %s| %s%s\n", expectedResult.tokens.c_str(), expectedResult.tree.c_str(), expectedResult.error.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main()
+{
+  auto     random   = Random(0x9E3779B97F4A7C15ull);
+  uint64_t failures = 0;
+
+  for (uint64_t session = 0; session < sessionsCount; session++)
+    failures += !checkSession(random, session);
+
+  return failures > 0 ? 1 : 0;
+}
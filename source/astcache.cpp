@@ -0,0 +1,88 @@
+#include "astcache.h"
+
+uint32_t NScript::AstCache::hashText(const std::string& text)
+{
+  uint32_t hash = 2166136261u;
+
+  for (const auto& c : text)
+    hash = (hash ^ uint8_t(c)) * 16777619u;
+
+  return hash;
+}
+
+NScript::AstCacheEntry* NScript::AstCache::findEntry(uint32_t hash, const std::string& text)
+{
+  // the texts are compared only when the hashes match
+  for (auto& entry : entries)
+    if (entry.hash == hash && entry.text == text)
+    {
+      entry.lastUse = ++useClock;
+      return &entry;
+    }
+
+  return nullptr;
+}
+
+const NScript::AstCacheEntry* NScript::AstCache::find(const std::string& text)
+{
+  auto entry = findEntry(hashText(text), text);
+
+  if (entry)
+    hits++;
+  else
+    misses++;
+
+  return entry;
+}
+
+void NScript::AstCache::add(const std::string& text, const Node& tree, const std::vector<uint8_t>& palettes)
+{
+  auto hash = hashText(text);
+
+  // a prompt typed again is already cached, it's only marked as used
+  if (findEntry(hash, text))
+    return;
+
+  auto scope       = AllocationScope(AllocationCategory::Ast);
+  auto bytesBefore = allocationCounter.totalLiveBytes;
+  auto entry       = (AstCacheEntry) {
+    .hash     = hash,
+    .text     = text,
+    .tree     = Parser::cloneTree(tree),
+    .palettes = palettes,
+    .bytes    = 0,
+    .lastUse  = ++useClock,
+  };
+
+  // what the entry takes is measured rather than estimated
+  entry.bytes = allocationCounter.totalLiveBytes - bytesBefore + sizeof(AstCacheEntry);
+
+  if (entry.bytes > maxBytes)
+  {
+    Parser::deleteTree(entry.tree);
+    return;
+  }
+
+  evictUntilFits(maxBytes - entry.bytes);
+
+  entries.push_back(entry);
+  usedBytes += entry.bytes;
+}
+
+void NScript::AstCache::setMaxBytes(uint64_t bytes)
+{
+  maxBytes = bytes;
+  evictUntilFits(maxBytes);
+}
+
+void NScript::AstCache::evictUntilFits(uint64_t bytes)
+{
+  while (usedBytes > bytes)
+  {
+    auto oldest = std::min_element(entries.begin(), entries.end(), [] (const AstCacheEntry& a, const AstCacheEntry& b) { return a.lastUse < b.lastUse; });
+
+    usedBytes -= oldest->bytes;
+    Parser::deleteTree(oldest->tree);
+    entries.erase(oldest);
+  }
+}
\ No newline at end of file
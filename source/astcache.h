@@ -0,0 +1,79 @@
+#pragma once
+
+#include <nds.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+#include "nscript.h"
+
+namespace NScript
+{
+  // the parsed prompts kept by the cache can't take more than these bytes (trees, texts and palettes)
+  const uint64_t defaultAstCacheBytes = 16 * 1024;
+
+  class AstCacheEntry
+  {
+    public: uint32_t             hash;
+    public: std::string          text;
+    public: Node                 tree;     // owned by the cache, never modified
+    public: std::vector<uint8_t> palettes; // the highlighting of the text, restored along with the tree
+    public: uint64_t             bytes;
+    public: uint64_t             lastUse;
+  };
+
+  // maps the text of the prompts to their parsed trees, so that recalled prompts are not parsed again
+  class AstCache
+  {
+    private: std::vector<AstCacheEntry> entries;
+    private: uint64_t                   usedBytes;
+    private: uint64_t                   maxBytes;
+    private: uint64_t                   useClock;
+
+    public: uint64_t hits;
+    public: uint64_t misses;
+
+    public: AstCache()
+    {
+      this->entries   = std::vector<AstCacheEntry>();
+      this->usedBytes = 0;
+      this->maxBytes  = defaultAstCacheBytes;
+      this->useClock  = 0;
+      this->hits      = 0;
+      this->misses    = 0;
+    }
+
+    public: ~AstCache()
+    {
+      setMaxBytes(0);
+    }
+
+    // returns the entry parsed from `text`, or null
+    public: const AstCacheEntry* find(const std::string& text);
+
+    // stores a copy of the tree parsed from `text` (unless it's already stored), the least recently used entries are dropped
+    // to make room
+    public: void add(const std::string& text, const Node& tree, const std::vector<uint8_t>& palettes);
+
+    public: void setMaxBytes(uint64_t bytes);
+
+    public: inline uint64_t getUsedBytes() const
+    {
+      return usedBytes;
+    }
+
+    public: inline uint64_t getEntriesCount() const
+    {
+      return entries.size();
+    }
+
+    // returns the entry of `text` (marking it as used), or null
+    private: AstCacheEntry* findEntry(uint32_t hash, const std::string& text);
+
+    // drops the least recently used entries until they take no more than `bytes`
+    private: void evictUntilFits(uint64_t bytes);
+
+    // fnv-1a
+    private: static uint32_t hashText(const std::string& text);
+  };
+}
\ No newline at end of file
@@ -2,18 +2,231 @@
 
 #include <nds.h>
 #include <dirent.h>
+#include <malloc.h>
+#include <fat.h>
 
-void panic(std::string msg)
+#ifndef ARM9
+#include <mutex>
+#include <atomic>
+#endif
+
+PER_THREAD AllocationCounter allocationCounter = { 0, 0, { 0 }, 0, 0, AllocationCategory::Other, false };
+
+static PER_THREAD void* emergencyReserve = nullptr;
+
+static cstring_t allocationCategoryNames[] = { "other", "ast", "strings", "variables", "history", "io" };
+
+static BootPhase bootPhases[maxBootPhases];
+static uint64_t  bootPhasesCount   = 0;
+static uint32_t  lastBootMarkTicks = 0;
+
+// on the host any worker of the runner can reach the lazy mount, so the mount and the phase it records are guarded
+#ifdef ARM9
+static bool              isFilesystemMounted = false;
+#else
+static std::atomic<bool> isFilesystemMounted = false;
+static std::mutex        mountMutex;
+#endif
+
+// every block allocated by `new` starts with this header (padded to keep the block aligned), so that `delete` knows what to uncount
+class AllocationHeader
+{
+  public: uint32_t           size;
+  public: AllocationCategory category;
+};
+
+const uint64_t allocationHeaderSize = alignof(max_align_t);
+
+void* operator new(size_t size)
+{
+  auto header = (AllocationHeader*)malloc(size + allocationHeaderSize);
+
+  // releasing the reserve, the caller will find out through isOutOfMemory
+  if (!header && emergencyReserve)
+  {
+    free(emergencyReserve);
+    emergencyReserve                = nullptr;
+    allocationCounter.isOutOfMemory = true;
+
+    header = (AllocationHeader*)malloc(size + allocationHeaderSize);
+  }
+
+  if (!header)
+    panic("out of memory");
+
+  header->size     = size;
+  header->category = allocationCounter.currentCategory;
+  allocationCounter.add(header->category, size);
+
+  return (uint8_t*)header + allocationHeaderSize;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  if (!p)
+    return;
+
+  auto header = (AllocationHeader*)((uint8_t*)p - allocationHeaderSize);
+
+  allocationCounter.remove(header->category, header->size);
+  free(header);
+}
+
+void operator delete[](void* p) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete(void* p, size_t size) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t size) noexcept
+{
+  operator delete(p);
+}
+
+void reserveEmergencyMemory()
 {
-  printf("[!] sys panic `%s`\n", msg.c_str());
+  if (!emergencyReserve)
+    emergencyReserve = malloc(emergencyReserveSize);
+}
+
+uint64_t getLargestFreeBlock()
+{
+  auto info = mallinfo();
+
+  // the free chunks plus the space the heap can still grow into
+  uint64_t low  = 0;
+  uint64_t high = info.fordblks;
+
+#ifdef ARM9
+  high += getHeapLimit() - getHeapEnd();
+#endif
+
+  // searching the biggest size malloc accepts
+  while (low < high)
+  {
+    auto middle = low + (high - low + 1) / 2;
+    auto block  = malloc(middle);
+
+    if (block)
+    {
+      free(block);
+      low = middle;
+    }
+    else
+      high = middle - 1;
+  }
+
+  return low;
+}
+
+void printAllocationReport(FILE* output, const AllocationCounter& counter)
+{
+  auto info = mallinfo();
+
+  fiprintf(output, "live %lu B (peak %lu B)\n", (unsigned long)counter.totalLiveBytes, (unsigned long)counter.peakLiveBytes);
+
+  for (uint64_t i = 0; i < uint64_t(AllocationCategory::Count); i++)
+    fiprintf(output, "  %-10s%lu B\n", allocationCategoryNames[i], (unsigned long)counter.liveBytes[i]);
+
+  fiprintf(output, "heap %lu B (used %lu B)\n", (unsigned long)info.arena, (unsigned long)info.uordblks);
+  fiprintf(output, "largest free block %lu B\n", (unsigned long)getLargestFreeBlock());
+}
+
+static void recordBootPhase(cstring_t name, uint32_t startTicks, uint32_t endTicks)
+{
+  if (bootPhasesCount < maxBootPhases)
+    bootPhases[bootPhasesCount++] = (BootPhase) { .name = name, .startTicks = startTicks, .ticks = endTicks - startTicks };
+}
+
+static inline unsigned long ticksToMicroseconds(uint32_t ticks)
+{
+  return (unsigned long)(uint64_t(ticks) * 1000000 / BUS_CLOCK);
+}
+
+void startBootTiming()
+{
+  cpuStartTiming(0);
+  lastBootMarkTicks = cpuGetTiming();
+}
+
+void markBootPhase(cstring_t name)
+{
+  auto now = cpuGetTiming();
+
+  recordBootPhase(name, lastBootMarkTicks, now);
+  lastBootMarkTicks = now;
+}
+
+void printBootReport(FILE* output)
+{
+#ifndef ARM9
+  auto lock = std::lock_guard<std::mutex>(mountMutex);
+#endif
+
+  for (uint64_t i = 0; i < bootPhasesCount; i++)
+    fiprintf(output, "%-10s%8lu us (at %lu us)\n", bootPhases[i].name, ticksToMicroseconds(bootPhases[i].ticks), ticksToMicroseconds(bootPhases[i].startTicks));
+
+  // the time to the first prompt is where its phase ends
+  for (uint64_t i = 0; i < bootPhasesCount; i++)
+    if (!strcmp(bootPhases[i].name, "prompt"))
+      fiprintf(output, "first prompt after %lu us\n", ticksToMicroseconds(bootPhases[i].startTicks + bootPhases[i].ticks));
+
+  if (!isFilesystemMounted)
+    fiprintf(output, "fat not mounted yet\n");
+}
+
+bool mountFilesystem()
+{
+  if (isFilesystemMounted)
+    return true;
+
+#ifndef ARM9
+  auto lock = std::lock_guard<std::mutex>(mountMutex);
+
+  // another worker may have mounted it while this one was waiting
+  if (isFilesystemMounted)
+    return true;
+#endif
+
+  // a failed mount is tried again the next time (the card may have been inserted meanwhile)
+  auto startTicks = cpuGetTiming();
+  auto isMounted  = fatInitDefault();
+
+  if (isMounted)
+    recordBootPhase("fat", startTicks, cpuGetTiming());
+
+  // set last, so that a worker which sees it mounted never races with the phase being recorded
+  isFilesystemMounted = isMounted;
+  return isMounted;
+}
+
+void panic(cstring_t msg)
+{
+  // the message is not a std::string, so panic can be called even when the heap is exhausted
+  printf("[!] sys panic `%s`\n", msg);
   fflush(stdout);
 
+#ifdef ARM9
   // keeping opened the process to show the message
   while (true) swiWaitForVBlank();
+#else
+  abort();
+#endif
 }
 
 cstring_t cstringRealloc(cstring_t s)
 {
+  auto scope = AllocationScope(AllocationCategory::Strings);
+
   // including the null terminator
   auto temp = new char[strlen(s) + 1];
 
@@ -84,26 +297,78 @@ std::string addTrailingSlashToPath(std::string dir)
   return dir;
 }
 
-void removeAllInsideDir(std::string path)
+std::string removeTrailingSlashFromPath(std::string path)
 {
-  auto dir = opendir(path.c_str());
+  // the root keeps its slash
+  while (path.length() > 1 && path[path.length() - 1] == '/')
+    path.pop_back();
 
-  if (!dir)
-    return;
+  return path;
+}
+
+std::string getPathName(std::string path)
+{
+  path = removeTrailingSlashFromPath(path);
+
+  return path.substr(path.rfind('/') + 1);
+}
+
+bool copyFile(cstring_t sourcePath, cstring_t destinationPath)
+{
+  auto source = fopen(sourcePath, "rb");
+
+  if (!source)
+    return false;
 
-  // iterating the directory
-  while (auto entry = readdir(dir))
+  // the blocks bypass the small buffers of the FILEs, so that the fat driver moves whole sectors from and to the aligned buffer,
+  // it's allocated before the destination is opened, so that a copy which can't start leaves an existing destination untouched
+  auto buffer = (char*)memalign(512, copyBlockSize);
+
+  if (!buffer)
   {
-    if (entry->d_name == std::string(".") || entry->d_name == std::string(".."))
-      continue;
+    fclose(source);
+    return false;
+  }
 
-    auto fullElemPath = path + '/' + entry->d_name;
+  allocationCounter.add(AllocationCategory::Io, copyBlockSize);
 
-    if (entry->d_type == DT_DIR)
-      removeAllInsideDir(fullElemPath);
-    else
-      remove(fullElemPath.c_str());
+  auto destination = fopen(destinationPath, "wb");
+  auto isOk        = true;
+
+  if (!destination)
+  {
+    allocationCounter.remove(AllocationCategory::Io, copyBlockSize);
+    free(buffer);
+    fclose(source);
+    return false;
   }
-  
-  closedir(dir);
+
+  setvbuf(source, nullptr, _IONBF, 0);
+  setvbuf(destination, nullptr, _IONBF, 0);
+
+  while (isOk)
+  {
+    auto read = fread(buffer, 1, copyBlockSize, source);
+
+    if (read > 0 && fwrite(buffer, 1, read, destination) != read)
+      isOk = false;
+
+    if (read < copyBlockSize)
+    {
+      isOk = isOk && !ferror(source);
+      break;
+    }
+  }
+
+  allocationCounter.remove(AllocationCategory::Io, copyBlockSize);
+  free(buffer);
+  fclose(source);
+
+  if (fclose(destination))
+    isOk = false;
+
+  if (!isOk)
+    remove(destinationPath);
+
+  return isOk;
 }
\ No newline at end of file
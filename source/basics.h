@@ -9,7 +9,110 @@
 typedef const char* cstring_t;
 typedef char void_t;
 
-void panic(std::string msg);
+// the ds runs a single thread, the host runner evaluates on several ones and each of them needs its own allocation accounting
+#ifdef ARM9
+#define PER_THREAD
+#else
+#define PER_THREAD thread_local
+#endif
+
+// what the allocations are made for, the allocations made by `new` are tagged with the current category
+enum class AllocationCategory : uint8_t
+{
+  Other,
+  Ast,       // tokens and nodes of the parsed expressions
+  Strings,   // string values
+  Variables, // the variables' map
+  History,   // the prompt buffers
+  Io,        // file buffers and pipeline stages
+  Count,
+};
+
+// counts every allocation made through the global `new` operators
+// tests can assert that a code path does not allocate by comparing `allocatedBytes` around it,
+// as host/tests/units/allocations.cpp does for the arithmetic
+class AllocationCounter
+{
+  public: uint64_t           allocatedBytes;                                // bytes requested since boot
+  public: uint64_t           allocationsCount;                              // number of allocations since boot
+  public: uint64_t           liveBytes[uint64_t(AllocationCategory::Count)]; // bytes not freed yet, for each category
+  public: uint64_t           totalLiveBytes;
+  public: uint64_t           peakLiveBytes;                                 // the highest totalLiveBytes reached
+  public: AllocationCategory currentCategory;
+  public: bool               isOutOfMemory;                                 // set when `new` had to use the emergency reserve
+
+  // records an allocation, `new` calls it on its own, the other allocators (such as `memalign`) must call it by hand
+  public: inline void add(AllocationCategory category, uint64_t size)
+  {
+    allocatedBytes                += size;
+    allocationsCount              += 1;
+    liveBytes[uint64_t(category)] += size;
+    totalLiveBytes                += size;
+    peakLiveBytes                  = std::max(peakLiveBytes, totalLiveBytes);
+  }
+
+  public: inline void remove(AllocationCategory category, uint64_t size)
+  {
+    liveBytes[uint64_t(category)] -= size;
+    totalLiveBytes                -= size;
+  }
+};
+
+extern PER_THREAD AllocationCounter allocationCounter;
+
+// memory kept aside, when `new` fails it's released so that the allocation can still succeed and the failure can be reported as an error
+const uint64_t emergencyReserveSize = 16 * 1024;
+
+// sets aside the emergency reserve again (after it was used), does nothing when it's already set aside
+void reserveEmergencyMemory();
+
+// tags the allocations made while it's alive, then restores the previous category:
+//  `auto scope = AllocationScope(AllocationCategory::Ast);`
+class AllocationScope
+{
+  private: AllocationCategory previousCategory;
+
+  public: AllocationScope(AllocationCategory category)
+  {
+    this->previousCategory            = allocationCounter.currentCategory;
+    allocationCounter.currentCategory = category;
+  }
+
+  public: ~AllocationScope()
+  {
+    allocationCounter.currentCategory = previousCategory;
+  }
+};
+
+// prints the live bytes of each category (counted by `counter`) and the state of the heap
+void printAllocationReport(FILE* output, const AllocationCounter& counter);
+
+// the size of the biggest block which can still be allocated
+uint64_t getLargestFreeBlock();
+
+// the boot is timed with the cpu timing of libnds (timers 0 and 1), up to this many phases are recorded
+const uint64_t maxBootPhases = 8;
+
+class BootPhase
+{
+  public: cstring_t name;
+  public: uint32_t  startTicks; // since the timing started
+  public: uint32_t  ticks;
+};
+
+// must be called first thing in main()
+void startBootTiming();
+
+// records a phase which took the time since the previous phase ended (or since the timing started)
+void markBootPhase(cstring_t name);
+
+// prints how long each phase took and when it started
+void printBootReport(FILE* output);
+
+// mounts the fat filesystem the first time it's needed (the mount can be slow on some flashcarts), returns false when it failed
+bool mountFilesystem();
+
+void panic(cstring_t msg);
 
 // NOTE: `s` won't be freed
 // in this project cstringRealloc is called on .c_str() to have the guarantee that the pointer will not be implicitly deallocated in any case.
@@ -30,7 +133,7 @@ std::string getRealPath(std::string path);
 
 std::vector<std::string> splitString(char toSplit, std::string s);
 
-template <typename T> std::string joinArray(std::string sep, std::vector<T> arr, std::function<std::string(T)> toStringRemapper)
+template <typename T> std::string joinArray(std::string sep, const std::vector<T>& arr, std::function<std::string(T)> toStringRemapper)
 {
   auto result = std::string();
 
@@ -46,9 +149,28 @@ template <typename T> std::string joinArray(std::string sep, std::vector<T> arr,
   return result;
 }
 
+template <typename T> inline bool arrayContains(const std::vector<T>& array, T elem)
+{
+  for (const auto& e : array)
+    if (e == elem)
+      return true;
+
+  return false;
+}
+
 std::string addTrailingSlashToPath(std::string dir);
 
-void removeAllInsideDir(std::string path);
+// `/foo/bar/` -> `/foo/bar`
+std::string removeTrailingSlashFromPath(std::string path);
+
+// `/foo/bar/` -> `bar`
+std::string getPathName(std::string path);
+
+// files are copied in blocks of this size, a multiple of the sd card's sectors (512 bytes)
+const uint64_t copyBlockSize = 32 * 1024;
+
+// copies the content of a file, returns false on failure (the partial destination is then removed)
+bool copyFile(cstring_t sourcePath, cstring_t destinationPath);
 
 template<typename Tk, typename Tv> class KeyPair
 {
@@ -0,0 +1,168 @@
+#include "checksum.h"
+
+// the crc of each byte followed by 0 to 7 zero bytes, built the first time they are needed
+static uint32_t crc32Tables[8][256];
+static uint16_t crc16Table[256];
+
+static bool buildChecksumTables()
+{
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    uint32_t crc32 = i;
+    uint32_t crc16 = i;
+
+    for (uint64_t bit = 0; bit < 8; bit++)
+    {
+      crc32 = crc32 & 1 ? (crc32 >> 1) ^ 0xEDB88320 : crc32 >> 1;
+      crc16 = crc16 & 1 ? (crc16 >> 1) ^ 0xA001 : crc16 >> 1;
+    }
+
+    crc32Tables[0][i] = crc32;
+    crc16Table[i]     = uint16_t(crc16);
+  }
+
+  for (uint64_t t = 1; t < 8; t++)
+    for (uint32_t i = 0; i < 256; i++)
+      crc32Tables[t][i] = (crc32Tables[t - 1][i] >> 8) ^ crc32Tables[0][crc32Tables[t - 1][i] & 0xFF];
+
+  return true;
+}
+
+static inline uint32_t readWord(const uint8_t* p)
+{
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+static inline uint32_t rotateLeft(uint32_t x, uint32_t bits)
+{
+  return (x << bits) | (x >> (32 - bits));
+}
+
+NScript::Checksum::Checksum(ChecksumKind kind, uint32_t seed)
+{
+  this->kind       = kind;
+  this->length     = 0;
+  this->tailLength = 0;
+
+  // crc32 keeps its state inverted, so that the result of a checksum is a valid seed
+  this->state = kind == ChecksumKind::Crc32 ? ~seed : seed;
+
+  // a function static is initialized exactly once, even when the evaluators of the host runner race for it
+  static const auto areTablesReady = buildChecksumTables();
+
+  (void)areTablesReady;
+}
+
+void NScript::Checksum::update(const uint8_t* data, uint64_t length)
+{
+  switch (kind)
+  {
+    case ChecksumKind::Crc32: updateCrc32(data, length); break;
+    case ChecksumKind::Crc16: updateCrc16(data, length); break;
+    case ChecksumKind::Hash:  updateHash(data, length);  break;
+  }
+
+  this->length += length;
+}
+
+void NScript::Checksum::updateCrc32(const uint8_t* data, uint64_t length)
+{
+  auto crc = state;
+
+  // the words are read aligned (the arm9 can't load unaligned words)
+  for (; length > 0 && uintptr_t(data) % 4 != 0; length--)
+    crc = (crc >> 8) ^ crc32Tables[0][(crc ^ *data++) & 0xFF];
+
+  for (; length >= 8; length -= 8, data += 8)
+  {
+    auto low  = *(const uint32_t*)data ^ crc;
+    auto high = *(const uint32_t*)(data + 4);
+
+    crc = crc32Tables[7][low & 0xFF]          ^ crc32Tables[6][(low >> 8) & 0xFF]  ^
+          crc32Tables[5][(low >> 16) & 0xFF]  ^ crc32Tables[4][low >> 24]          ^
+          crc32Tables[3][high & 0xFF]         ^ crc32Tables[2][(high >> 8) & 0xFF] ^
+          crc32Tables[1][(high >> 16) & 0xFF] ^ crc32Tables[0][high >> 24];
+  }
+
+  for (; length > 0; length--)
+    crc = (crc >> 8) ^ crc32Tables[0][(crc ^ *data++) & 0xFF];
+
+  state = crc;
+}
+
+void NScript::Checksum::updateCrc16(const uint8_t* data, uint64_t length)
+{
+  auto crc = uint16_t(state);
+
+#ifdef ARM9
+  // the bios takes aligned halfwords
+  if (uintptr_t(data) % 2 == 0 && length >= 2)
+  {
+    auto even = length & ~uint64_t(1);
+
+    crc     = swiCRC16(crc, (void*)data, even);
+    data   += even;
+    length -= even;
+  }
+#endif
+
+  for (; length > 0; length--)
+    crc = (crc >> 8) ^ crc16Table[(crc ^ *data++) & 0xFF];
+
+  state = crc;
+}
+
+void NScript::Checksum::updateHash(const uint8_t* data, uint64_t length)
+{
+  auto h = state;
+
+  auto mixWord = [&h] (uint32_t k) {
+    k  = rotateLeft(k * 0xCC9E2D51, 15) * 0x1B873593;
+    h  = rotateLeft(h ^ k, 13) * 5 + 0xE6546B64;
+  };
+
+  // completing the word left by the previous block
+  for (; tailLength > 0 && tailLength < 4 && length > 0; length--)
+    tail[tailLength++] = *data++;
+
+  if (tailLength == 4)
+  {
+    mixWord(readWord(tail));
+    tailLength = 0;
+  }
+
+  for (; length >= 4; length -= 4, data += 4)
+    mixWord(readWord(data));
+
+  for (; length > 0; length--)
+    tail[tailLength++] = *data++;
+
+  state = h;
+}
+
+uint32_t NScript::Checksum::finish()
+{
+  if (kind == ChecksumKind::Crc32)
+    return ~state;
+
+  if (kind == ChecksumKind::Crc16)
+    return state;
+
+  auto     h = state;
+  uint32_t k = 0;
+
+  for (auto i = tailLength; i > 0; i--)
+    k = (k << 8) | tail[i - 1];
+
+  if (tailLength > 0)
+    h ^= rotateLeft(k * 0xCC9E2D51, 15) * 0x1B873593;
+
+  h ^= uint32_t(length);
+  h ^= h >> 16;
+  h *= 0x85EBCA6B;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35;
+  h ^= h >> 16;
+
+  return h;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // files are checksummed while they are read in blocks of this size
+  const uint64_t checksumBlockSize = 32 * 1024;
+
+  // `crc16(path)` starts from this value, as the bios and modbus do
+  const uint32_t defaultCrc16Seed = 0xFFFF;
+
+  enum class ChecksumKind : uint8_t
+  {
+    Crc32, // the one of zip and png (reflected 0xEDB88320), computed 8 bytes at a time with the slicing-by-8 tables
+    Crc16, // the one of `swiCRC16` (reflected 0xA001)
+    Hash,  // murmur3 (32 bits), not cryptographic
+  };
+
+  // a checksum computed one block after the other, so that the blocks of a file don't have to be in memory together:
+  //  `auto c = Checksum(ChecksumKind::Crc32, 0); c.update(a, aLength); c.update(b, bLength); c.finish();`
+  // the result of a checksum can be used as the seed of the next one, crc32 and crc16 then continue as over the concatenated data
+  class Checksum
+  {
+    private: ChecksumKind kind;
+    private: uint32_t     state;
+    private: uint64_t     length;     // the bytes checksummed so far (murmur3 mixes it in at the end)
+    private: uint8_t      tail[4];    // the bytes after the last complete word (murmur3 takes words)
+    private: uint64_t     tailLength;
+
+    public: Checksum(ChecksumKind kind, uint32_t seed);
+
+    public: void update(const uint8_t* data, uint64_t length);
+
+    public: uint32_t finish();
+
+    private: void updateCrc32(const uint8_t* data, uint64_t length);
+
+    private: void updateCrc16(const uint8_t* data, uint64_t length);
+
+    private: void updateHash(const uint8_t* data, uint64_t length);
+  };
+}
\ No newline at end of file
@@ -1,5 +1,43 @@
 #include "console.h"
 
+void NDSConsole::updateFrame(uint64_t frame, const NScript::InputFrame& liveInput, FrameTiming& timing)
+{
+  // while replaying, the recorded input takes the place of the live one
+  auto input      = inputLog.nextFrame(liveInput);
+  auto inputTicks = cpuGetTiming();
+
+  // when virtual key is pressed
+  if (input.keyboardKey != NOKEY)
+    processVirtualKey(input.keyboardKey);
+
+  // processing the physical button keys
+  switch (input.buttonKeys)
+  {
+    case KEY_LEFT:  moveCursorIndex(MovingDirection2D::LeftOrUp);     break;
+    case KEY_RIGHT: moveCursorIndex(MovingDirection2D::RightOrDown);  break;
+    case KEY_UP:    moveRecentBuffer(MovingDirection2D::LeftOrUp);    break;
+    case KEY_DOWN:  moveRecentBuffer(MovingDirection2D::RightOrDown); break;
+    case KEY_B:     removeChar();                                     break;
+    case KEY_A:     returnPrompt();                                   break;
+    case KEY_X:     scrollScreen(MovingDirection2D::LeftOrUp);        break;
+    case KEY_Y:     scrollScreen(MovingDirection2D::RightOrDown);     break;
+  }
+
+  auto parseTicks = cpuGetTiming();
+
+  // parsing the prompt while the user types it
+  parsePromptIncrementally();
+
+  auto flushTicks = cpuGetTiming();
+
+  // printing the prompt
+  flushPromptBuffer(frame, true);
+
+  timing.inputTicks = parseTicks - inputTicks;
+  timing.parseTicks = flushTicks - parseTicks;
+  timing.flushTicks = cpuGetTiming() - flushTicks;
+}
+
 void NDSConsole::processVirtualKey(int key)
 {
   // remapping some special virtual keyboard keys
@@ -45,6 +83,8 @@ void NDSConsole::processVirtualKey(int key)
 
 void NDSConsole::insertChar(char c)
 {
+  auto scope = AllocationScope(AllocationCategory::History);
+
   // the letter has to be added at the top of the string
   if (promptCursorIndex == promptBuffer->length())
   {
@@ -54,6 +94,10 @@ void NDSConsole::insertChar(char c)
   // the letter has to be inserted inside the string
   else
     promptBuffer->insert(promptBuffer->begin() + promptCursorIndex++, c);
+
+  // the new char is highlighted once the tokens after the edit are lexed again
+  promptPalettes.insert(promptPalettes.begin() + promptCursorIndex - 1, defaultPalette);
+  editLivePrompt(promptCursorIndex - 1);
   
   // setting the max reached prompt length whether the current prompt length is greater
   if (promptBuffer->length() > maxReachedPromptLength)
@@ -71,35 +115,93 @@ void NDSConsole::removeChar()
   {
     promptBuffer->pop_back();
     promptCursorIndex--;
-    return;
   }
-
   // the letter to remove is inside the string
-  promptBuffer->erase(promptBuffer->begin() + --promptCursorIndex);
+  else
+    promptBuffer->erase(promptBuffer->begin() + --promptCursorIndex);
+
+  promptPalettes.erase(promptPalettes.begin() + promptCursorIndex);
+  editLivePrompt(promptCursorIndex);
 }
 
 void NDSConsole::flushPromptBuffer(uint64_t frame, bool printCursor)
 {
-  // going back at the end of the prompt prefix
-  printableConsole->cursorX = getPromptPrefix().length();
+  auto cursorCells = uint64_t(printCursor);
+  auto cellsCount  = maxReachedPromptLength + 1 + cursorCells;
 
-  // printing the buffer and the cursor
-  for (uint64_t i = 0; i < promptBuffer->length(); i++)
+  scrollToFitPrompt(cellsCount);
+
+  // the part of a prompt taller than the window is not drawn
+  cellsCount = std::min(cellsCount, uint64_t(printableConsole->windowWidth * printableConsole->windowHeight) - promptStartCell);
+
+  // drawing the tiles straight into the map, skipping the ones which did not change since the last frame
+  for (uint64_t i = 0; i < cellsCount; i++)
   {
-    // printing the cursor when it's inside the string
-    if (i == promptCursorIndex)
-      printBlinkingCursor(frame, printCursor);
+    // the cursor takes a cell, the following chars are shifted by one
+    auto charIndex = i > promptCursorIndex ? i - cursorCells : i;
+    auto entry     = u16();
+
+    if (printCursor && i == promptCursorIndex)
+      entry = getTileEntry(getBlinkingCursor(frame), defaultPalette);
+    // replacing the overflowed letters with spaces
+    else if (charIndex >= promptBuffer->length())
+      entry = getTileEntry(' ', defaultPalette);
+    // the chars of a syntax error are highlighted while typing
+    else if (isInLivePromptError(charIndex))
+      entry = getTileEntry(promptBuffer->at(charIndex), uint8_t(ConsolePalette::Red));
+    else
+      entry = getTileEntry(promptBuffer->at(charIndex), promptPalettes[charIndex]);
 
-    iprintf("%c", promptBuffer->at(i));
+    if (i < drawnPromptTiles.size() && drawnPromptTiles[i] == entry)
+      continue;
+    
+    if (i >= drawnPromptTiles.size())
+      drawnPromptTiles.resize(i + 1);
+
+    getWindowTile(promptStartCell + i) = entry;
+    drawnPromptTiles[i]                = entry;
   }
 
-  // printing the cursor when is on the top of the string
-  if (promptCursorIndex == promptBuffer->length())
-    printBlinkingCursor(frame, printCursor);
+  // moving the console cursor after the buffer, where the command output will start
+  auto endCell = promptStartCell + promptBuffer->length() + cursorCells;
 
-  // replacing the overflowed letters with spaces
-  for (uint64_t i = 0; i < maxReachedPromptLength + 1 - promptBuffer->length(); i++)
-    iprintf(" ");
+  printableConsole->cursorX = endCell % printableConsole->windowWidth;
+  printableConsole->cursorY = endCell / printableConsole->windowWidth;
+}
+
+void NDSConsole::scrollToFitPrompt(uint64_t cellsCount)
+{
+  auto width        = uint64_t(printableConsole->windowWidth);
+  auto windowCells  = width * printableConsole->windowHeight;
+  auto overflowRows = uint64_t(0);
+
+  if (promptStartCell + cellsCount > windowCells)
+    overflowRows = (promptStartCell + cellsCount - windowCells + width - 1) / width;
+
+  // the prompt cannot be taller than the window, its first rows are left out
+  overflowRows = std::min(overflowRows, promptStartCell / width);
+
+  if (overflowRows == 0)
+    return;
+
+  // new lines on the last row scroll up the whole window
+  printableConsole->cursorX = 0;
+  printableConsole->cursorY = printableConsole->windowHeight - 1;
+
+  for (uint64_t i = 0; i < overflowRows; i++)
+    iprintf("\n");
+
+  promptStartCell -= overflowRows * width;
+  drawnPromptTiles.clear();
+}
+
+void NDSConsole::printPromptPrefix()
+{
+  iprintf("\n%s", getPromptPrefix().c_str());
+
+  // the prompt buffer will be drawn tile by tile from here
+  promptStartCell = printableConsole->cursorY * printableConsole->windowWidth + printableConsole->cursorX;
+  drawnPromptTiles.clear();
 }
 
 void NDSConsole::moveCursorIndex(MovingDirection2D direction)
@@ -129,6 +231,17 @@ void NDSConsole::moveRecentBuffer(MovingDirection2D direction)
   recentPromptsIndex     += uint64_t(direction);
   this->promptBuffer      = recentPrompts[recentPromptsIndex];
   this->promptCursorIndex = promptBuffer->length();
+
+  // the overflowed letters of the old prompt have to be replaced with spaces
+  if (promptBuffer->length() > maxReachedPromptLength)
+    maxReachedPromptLength = promptBuffer->length();
+
+  // the whole prompt changed, an unchanged prompt which was already run doesn't need to be lexed or parsed
+  if (recallCachedLivePrompt())
+    return;
+
+  promptPalettes.assign(promptBuffer->length(), defaultPalette);
+  editLivePrompt(0);
 }
 
 void NDSConsole::scrollScreen(MovingDirection2D direction)
@@ -155,24 +268,43 @@ void NDSConsole::returnPrompt()
   // going to the next line for the prompted command output
   iprintf("\n");
 
-  try
-  {
-    // processing the prompted command
-    auto result = processCommand(*promptBuffer);
+  auto result = NScript::Node();
+  auto error  = NScript::Error();
 
+  // processing the prompted command
+  if (processCommand(result, error))
+  {
     // when the expression returns `none` it's not shown up
     if (result.kind != NScript::NodeKind::None)
-      iprintf("\n%s\n", result.toString().c_str());
+    {
+      iprintf("\n");
+      evaluator.printResult(result);
+      iprintf("\n");
+    }
   }
-  catch (const NScript::Error& e)
+  else
+    printPromptParsingError(error);
+
+  // a prompt parsed without errors is cached, so that recalling it from the history skips the parsing
+  if (isLivePromptParsed && !isLivePromptCached && !livePromptParser.failed())
   {
-    printPromptParsingError(e);
+    highlightLivePromptTokens();
+    astCache.add(*promptBuffer, livePromptTree, promptPalettes);
   }
 
+  auto scope = AllocationScope(AllocationCategory::History);
+
   // setting up the new prompt buffer
   // the old one is already saved on the top of recentPrompts
   this->promptBuffer      = new std::string();
   this->promptCursorIndex = 0;
+
+  // the evaluated tree is no longer needed, but its strings may be referenced by the variables and the cache (they are not freed)
+  dropLivePromptTree();
+  this->livePromptParser   = NScript::Parser();
+  this->promptPalettes.clear();
+  this->highlightedTokens      = 0;
+  this->maxReachedPromptLength = 0;
   
   // saving the new prompt buffer on the top of recentPrompts
   recentPromptsIndex      = recentPrompts.size();
@@ -182,7 +314,7 @@ void NDSConsole::returnPrompt()
   printPromptPrefix();
 }
 
-void NDSConsole::printPromptParsingError(NScript::Error e)
+void NDSConsole::printPromptParsingError(const NScript::Error& e)
 {
   auto promptLength = getPromptPrefix().length();
 
@@ -203,17 +335,156 @@ void NDSConsole::printPromptParsingError(NScript::Error e)
   iprintf("\n");
 }
 
-NScript::Node NDSConsole::processCommand(std::string command)
+bool NDSConsole::processCommand(NScript::Node& result, NScript::Error& error)
 {
-  NScript::Parser parser(command);
-  
-  return evaluator.evaluateNode(parser.parse());
+  // the prompt is usually already parsed during the idle frames, otherwise the parsing is completed now
+  if (!isLivePromptParsed)
+  {
+    livePromptTree     = livePromptParser.parse();
+    isLivePromptParsed = true;
+  }
+
+  auto expr = livePromptTree;
+
+  // the cached trees are parsed without errors, while the live parser has no tokens at all
+  if (!isLivePromptCached && livePromptParser.failed())
+  {
+    error = livePromptParser.error;
+    return false;
+  }
+
+  // the evaluator is reused across prompts, the previous error is no longer meaningful
+  evaluator.clearError();
+  result = evaluator.evaluateNode(expr);
+
+  if (evaluator.failed())
+  {
+    error = evaluator.error;
+    return false;
+  }
+
+  return true;
+}
+
+void NDSConsole::editLivePrompt(uint64_t editedIndex)
+{
+  // the old tree points to tokens which are going to be dropped, an edited cached prompt no longer matches its tree
+  // and is lexed again from the start, since the live parser has no tokens of it
+  if (isLivePromptCached)
+    editedIndex = 0;
+
+  dropLivePromptTree();
+  livePromptParser.edit(*promptBuffer, editedIndex);
+
+  // the palettes of the kept tokens are still valid
+  highlightedTokens = std::min(highlightedTokens, uint64_t(livePromptParser.getTokens().size()));
 }
 
-void NDSConsole::printBlinkingCursor(uint64_t frame, bool printCursor)
+void NDSConsole::dropLivePromptTree()
 {
-  if (!printCursor)
+  if (isLivePromptParsed && !isLivePromptCached)
+    NScript::Parser::deleteTree(livePromptTree);
+
+  livePromptTree     = NScript::Node();
+  isLivePromptParsed = false;
+  isLivePromptCached = false;
+}
+
+bool NDSConsole::recallCachedLivePrompt()
+{
+  const auto* entry = astCache.find(*promptBuffer);
+
+  if (entry == nullptr)
+    return false;
+
+  // the tokens of the old prompt are freed as well, the live parser is left empty until the prompt is edited
+  dropLivePromptTree();
+  livePromptParser.edit(*promptBuffer, 0);
+
+  this->livePromptTree     = entry->tree;
+  this->isLivePromptParsed = true;
+  this->isLivePromptCached = true;
+  this->promptPalettes     = entry->palettes;
+  this->highlightedTokens  = 0;
+
+  return true;
+}
+
+void NDSConsole::parsePromptIncrementally()
+{
+  if (isLivePromptParsed)
+    return;
+
+  // the tokens are lexed in small steps, the parsing starts in the frame after the last token is lexed
+  if (!livePromptParser.isLexed())
+  {
+    livePromptParser.lex(livePromptTokensPerFrame);
+    highlightLivePromptTokens();
+    return;
+  }
+
+  if (livePromptParser.getTokens().size() > maxLiveParsedTokens)
     return;
 
-  iprintf(frame % 32 <= 16 ? " " : "|");
+  livePromptTree     = livePromptParser.parse();
+  isLivePromptParsed = true;
+}
+
+bool NDSConsole::isInLivePromptError(uint64_t index)
+{
+  if (!isLivePromptParsed || !livePromptParser.failed())
+    return false;
+
+  const auto& pos = livePromptParser.error.position;
+
+  return index >= pos.startPos && index < pos.endPos;
+}
+
+void NDSConsole::highlightLivePromptTokens()
+{
+  const auto& tokens  = livePromptParser.getTokens();
+  auto        fromPos = highlightedTokens > 0 ? uint64_t(tokens[highlightedTokens - 1].pos.endPos) : 0;
+
+  for (; highlightedTokens < tokens.size(); highlightedTokens++)
+  {
+    const auto& token   = tokens[highlightedTokens];
+    auto        palette = getTokenPalette(token);
+    auto        endPos  = std::min(uint64_t(token.pos.endPos), uint64_t(promptPalettes.size()));
+
+    // the whitespaces before the token
+    for (auto i = fromPos; i < std::min(uint64_t(token.pos.startPos), endPos); i++)
+      promptPalettes[i] = defaultPalette;
+
+    for (auto i = uint64_t(token.pos.startPos); i < endPos; i++)
+      promptPalettes[i] = palette;
+
+    fromPos = std::max(fromPos, endPos);
+  }
+}
+
+uint8_t NDSConsole::getTokenPalette(const NScript::Node& token)
+{
+  switch (token.kind)
+  {
+    case NScript::NodeKind::Num:        return uint8_t(ConsolePalette::Yellow);
+    case NScript::NodeKind::String:
+    case NScript::NodeKind::Bytes:      return uint8_t(ConsolePalette::Green);
+    case NScript::NodeKind::None:       return uint8_t(ConsolePalette::Magenta);
+    case NScript::NodeKind::Bad:        return uint8_t(ConsolePalette::Red);
+
+    case NScript::NodeKind::Identifier:
+      if (!strcmp(token.value.str, "def"))
+        return uint8_t(ConsolePalette::Magenta);
+
+      return NScript::Evaluator::isBuiltin(token.value.str) ? uint8_t(ConsolePalette::Cyan) : defaultPalette;
+
+    case NScript::NodeKind::Plus:
+    case NScript::NodeKind::Minus:
+    case NScript::NodeKind::Star:
+    case NScript::NodeKind::Slash:
+    case NScript::NodeKind::Eq:
+    case NScript::NodeKind::Pipe:       return uint8_t(ConsolePalette::Magenta);
+
+    default:                            return defaultPalette;
+  }
 }
\ No newline at end of file
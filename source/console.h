@@ -7,6 +7,8 @@
 
 #include "basics.h"
 #include "nscript.h"
+#include "astcache.h"
+#include "input.h"
 
 enum class MovingDirection2D
 {
@@ -14,6 +16,31 @@ enum class MovingDirection2D
   RightOrDown =  1,
 };
 
+// palettes of the libnds console font, the same of the `\x1b[30..37m` colors (+8 for the bright ones)
+enum class ConsolePalette : uint8_t
+{
+  Red     = 9,
+  Green   = 10,
+  Yellow  = 11,
+  Magenta = 13,
+  Cyan    = 14,
+};
+
+// how many tokens of the prompt are lexed in each idle frame, so that typing stays smooth even with long prompts
+const uint64_t livePromptTokensPerFrame = 48;
+
+// the parsing can't be split across frames, so a prompt longer than this (in tokens) is parsed only when it's returned
+// and gets no live error underlining (on the host a nested prompt takes ~0.4 us per token, so ~400 us for 1 KB)
+const uint64_t maxLiveParsedTokens = 128;
+
+// the cpu ticks spent by the parts of a frame of the main loop
+class FrameTiming
+{
+  public: u32 inputTicks; // processing the virtual key and the buttons (running the prompt included)
+  public: u32 parseTicks; // parsing the prompt incrementally
+  public: u32 flushTicks; // drawing the prompt
+};
+
 class NDSConsole
 {
   private: std::string*              promptBuffer;
@@ -24,6 +51,17 @@ class NDSConsole
   private: Keyboard*                 virtualKeyboard;
   private: PrintConsole*             printableConsole;
   private: NScript::Evaluator        evaluator;
+  private: NScript::Parser           livePromptParser;   // parses the prompt while it's being typed
+  private: NScript::Node             livePromptTree;     // the last tree parsed by livePromptParser
+  private: bool                      isLivePromptParsed; // true when livePromptTree matches the prompt buffer
+  private: bool                      isLivePromptCached; // true when livePromptTree is borrowed from astCache (the live parser has no tokens then)
+  private: NScript::AstCache         astCache;           // the trees of the prompts already run, recalled prompts are not parsed again
+  private: std::vector<uint8_t>      promptPalettes;     // highlighting palette of each prompt char, cached from the live tokens
+  private: uint64_t                  highlightedTokens;  // how many live tokens have their palettes in promptPalettes
+  private: std::vector<u16>          drawnPromptTiles;   // map entries drawn by the last flush, only the changed ones are rewritten
+  private: uint64_t                  promptStartCell;    // window cell where the prompt buffer starts (after the prefix)
+  private: uint8_t                   defaultPalette;     // palette of the plain text
+  private: NScript::InputLog         inputLog;           // records the input of the frames, or replays it
 
   public: NDSConsole(PrintConsole* printableConsole, Keyboard* virtalKeyboard)
   {
@@ -35,6 +73,21 @@ class NDSConsole
     this->virtualKeyboard        = virtualKeyboard;
     this->printableConsole       = printableConsole;
     this->evaluator              = NScript::Evaluator();
+    this->livePromptParser       = NScript::Parser();
+    this->livePromptTree         = NScript::Node();
+    this->isLivePromptParsed     = false;
+    this->isLivePromptCached     = false;
+    this->astCache               = NScript::AstCache();
+    this->promptPalettes         = std::vector<uint8_t>();
+    this->highlightedTokens      = 0;
+    this->drawnPromptTiles       = std::vector<u16>();
+    this->promptStartCell        = 0;
+    this->defaultPalette         = printableConsole->fontCurPal >> 12;
+    this->inputLog               = NScript::InputLog();
+
+    evaluator.astCache = &astCache;
+    evaluator.history  = &recentPrompts;
+    evaluator.inputLog = &inputLog;
 
     keyboardShow();
   }
@@ -43,8 +96,14 @@ class NDSConsole
   {
     for (const auto& prompt : recentPrompts)
       delete prompt;
+
+    // the frames of an unfinished recording are not lost
+    inputLog.stop();
   }
 
+  // processes the input of a frame (or the recorded one while replaying), then parses and draws the prompt
+  public: void updateFrame(uint64_t frame, const NScript::InputFrame& liveInput, FrameTiming& timing);
+
   public: void processVirtualKey(int key);
 
   public: void insertChar(char c);
@@ -61,19 +120,57 @@ class NDSConsole
 
   public: void returnPrompt();
 
-  public: inline void printPromptPrefix()
-  {
-    iprintf("\n%s", getPromptPrefix().c_str());
-  }
+  // advances the parsing of the prompt being typed, within the budget of a single frame
+  public: void parsePromptIncrementally();
+
+  public: void printPromptPrefix();
 
   private: inline std::string getPromptPrefix()
   {
     return evaluator.cwd + " $ ";
   }
 
-  private: void printPromptParsingError(NScript::Error e);
+  private: void printPromptParsingError(const NScript::Error& e);
+
+  // processes the prompt buffer, returns false when it could not be parsed or evaluated, `error` is then set
+  private: bool processCommand(NScript::Node& result, NScript::Error& error);
+
+  // notifies the live parser that the prompt buffer changed starting from `editedIndex`
+  private: void editLivePrompt(uint64_t editedIndex);
 
-  private: NScript::Node processCommand(std::string command);
+  // drops the live tree, unless it's borrowed from the cache
+  private: void dropLivePromptTree();
 
-  private: void printBlinkingCursor(uint64_t frame, bool printCursor);
+  // uses the cached tree of the prompt buffer when there's one, returns false otherwise
+  private: bool recallCachedLivePrompt();
+
+  // returns true when the char at `index` of the prompt is part of the live parsing error
+  private: bool isInLivePromptError(uint64_t index);
+
+  // computes the palettes of the live tokens which are not highlighted yet
+  private: void highlightLivePromptTokens();
+
+  private: uint8_t getTokenPalette(const NScript::Node& token);
+
+  // scrolls the console when the prompt buffer would overflow the bottom of the window
+  private: void scrollToFitPrompt(uint64_t cellsCount);
+
+  private: inline u16 getTileEntry(char c, uint8_t palette)
+  {
+    return u16(palette << 12) | u16(uint8_t(c) - printableConsole->font.asciiOffset + printableConsole->fontCharOffset);
+  }
+
+  private: inline u16& getWindowTile(uint64_t cell)
+  {
+    auto width = uint64_t(printableConsole->windowWidth);
+    auto x     = cell % width + printableConsole->windowX;
+    auto y     = cell / width + printableConsole->windowY;
+
+    return printableConsole->fontBgMap[x + y * printableConsole->consoleWidth];
+  }
+
+  private: inline char getBlinkingCursor(uint64_t frame)
+  {
+    return frame % 32 <= 16 ? ' ' : '|';
+  }
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "glob.h"
+
+NScript::Glob::Glob(const std::string& pattern)
+{
+  this->root         = "/";
+  this->compileError = nullptr;
+
+  auto isRootComplete = false;
+
+  for (uint64_t start = 0, end = 0; start < pattern.length(); start = end + 1)
+  {
+    end = pattern.find('/', start);
+
+    if (end == std::string::npos)
+      end = pattern.length();
+
+    auto segment = pattern.substr(start, end - start);
+
+    if (segment.empty() || segment == ".")
+      continue;
+
+    // the root is a plain path, the literal segments after the first wildcard are matched like the others
+    if (!isRootComplete && !hasWildcards(segment))
+    {
+      if (segment != "..")
+        root += segment + "/";
+      else if (root.length() > 1)
+        root.erase(root.rfind('/', root.length() - 2) + 1);
+
+      continue;
+    }
+
+    isRootComplete = true;
+
+    if (segment == "..")
+    {
+      compileError = "`..` can't follow a wildcard";
+      return;
+    }
+
+    if (segments.size() == maxGlobSegments)
+    {
+      compileError = "too many path elements";
+      return;
+    }
+
+    compileSegment(segment);
+
+    if (compileError)
+      return;
+  }
+}
+
+bool NScript::Glob::hasWildcards(const std::string& path)
+{
+  return path.find_first_of("*?[") != std::string::npos;
+}
+
+void NScript::Glob::compileSegment(const std::string& segment)
+{
+  auto compiled = GlobSegment();
+
+  compiled.isRecursive = segment == "**";
+
+  if (compiled.isRecursive)
+  {
+    segments.push_back(compiled);
+    return;
+  }
+
+  for (uint64_t i = 0; i < segment.length();)
+  {
+    auto c = segment[i];
+
+    if (c == '*')
+    {
+      // consecutive stars match the same as one
+      if (compiled.tokens.empty() || compiled.tokens.back().kind != GlobTokenKind::AnyChars)
+        compiled.tokens.push_back((GlobToken) { .kind = GlobTokenKind::AnyChars, .start = 0, .length = 0 });
+
+      i++;
+    }
+    else if (c == '?')
+    {
+      compiled.tokens.push_back((GlobToken) { .kind = GlobTokenKind::AnyChar, .start = 0, .length = 0 });
+      i++;
+    }
+    else if (c == '[')
+    {
+      auto length = compileClass(segment.c_str() + i + 1, segment.length() - i - 1);
+
+      if (length == 0)
+      {
+        compileError = "unterminated `[`";
+        return;
+      }
+
+      compiled.tokens.push_back((GlobToken) { .kind = GlobTokenKind::Class, .start = uint32_t(classes.size() - 1), .length = 0 });
+      i += length + 1;
+    }
+    else
+    {
+      // the plain chars are merged into a single literal
+      if (compiled.tokens.empty() || compiled.tokens.back().kind != GlobTokenKind::Literal)
+        compiled.tokens.push_back((GlobToken) { .kind = GlobTokenKind::Literal, .start = uint32_t(compiled.chars.length()), .length = 0 });
+
+      compiled.chars.push_back(c);
+      compiled.tokens.back().length++;
+      i++;
+    }
+  }
+
+  segments.push_back(compiled);
+}
+
+uint64_t NScript::Glob::compileClass(const char* pattern, uint64_t length)
+{
+  auto     compiled  = GlobClass();
+  uint64_t i         = 0;
+  auto     isNegated = length > 0 && (pattern[0] == '!' || pattern[0] == '^');
+
+  memset(compiled.bits, 0, sizeof(compiled.bits));
+
+  if (isNegated)
+    i++;
+
+  // a `]` right after the opening is part of the class
+  for (auto isFirst = true; i < length && (pattern[i] != ']' || isFirst); isFirst = false)
+  {
+    auto from = uint8_t(pattern[i]);
+    auto to   = from;
+
+    if (i + 2 < length && pattern[i + 1] == '-' && pattern[i + 2] != ']')
+    {
+      to = uint8_t(pattern[i + 2]);
+      i += 3;
+    }
+    else
+      i++;
+
+    for (auto c = uint64_t(from); c <= to; c++)
+      compiled.bits[c / 32] |= 1u << (c % 32);
+  }
+
+  if (i >= length)
+    return 0;
+
+  if (isNegated)
+    for (auto& word : compiled.bits)
+      word = ~word;
+
+  classes.push_back(compiled);
+  return i + 1;
+}
+
+bool NScript::Glob::matchesSegment(const GlobSegment& segment, const char* name, uint64_t length) const
+{
+  const auto& tokens = segment.tokens;
+  uint64_t    t      = 0;
+  uint64_t    n      = 0;
+
+  // where to restart when the tokens after the last star don't match, the star then takes one more char
+  // (the earlier stars never need to be retried, since all the other tokens match a fixed count of chars)
+  auto     hasStar   = false;
+  uint64_t starToken = 0;
+  uint64_t starName  = 0;
+
+  while (true)
+  {
+    if (t < tokens.size())
+    {
+      const auto& token     = tokens[t];
+      auto        isMatched = false;
+
+      switch (token.kind)
+      {
+        case GlobTokenKind::AnyChars:
+          hasStar   = true;
+          starToken = ++t;
+          starName  = n;
+          continue;
+
+        case GlobTokenKind::AnyChar:
+          isMatched = n < length;
+          n        += 1;
+          break;
+
+        case GlobTokenKind::Class:
+          isMatched = n < length && classes[token.start].contains(name[n]);
+          n        += 1;
+          break;
+
+        case GlobTokenKind::Literal:
+          isMatched = length - n >= token.length && !memcmp(name + n, segment.chars.c_str() + token.start, token.length);
+          n        += token.length;
+          break;
+      }
+
+      if (isMatched)
+      {
+        t++;
+        continue;
+      }
+    }
+    else if (n == length)
+      return true;
+
+    if (!hasStar || starName >= length)
+      return false;
+
+    t = starToken;
+    n = ++starName;
+  }
+}
+
+uint64_t NScript::Glob::closeStates(uint64_t states) const
+{
+  for (uint64_t i = 0; i < segments.size(); i++)
+    if ((states & (uint64_t(1) << i)) && segments[i].isRecursive)
+      states |= uint64_t(1) << (i + 1);
+
+  return states;
+}
+
+uint64_t NScript::Glob::getStartStates() const
+{
+  return closeStates(1);
+}
+
+uint64_t NScript::Glob::step(uint64_t states, const char* name, uint64_t length) const
+{
+  uint64_t next = 0;
+
+  for (uint64_t i = 0; i < segments.size(); i++)
+  {
+    if (!(states & (uint64_t(1) << i)))
+      continue;
+
+    // `**` takes the directory and stays where it is
+    if (segments[i].isRecursive)
+      next |= uint64_t(1) << i;
+    else if (matchesSegment(segments[i], name, length))
+      next |= uint64_t(1) << (i + 1);
+  }
+
+  return closeStates(next);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <nds.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // the segments of a glob after its literal root, each one is a bit of the matching states
+  const uint64_t maxGlobSegments = 63;
+
+  enum class GlobTokenKind : uint8_t
+  {
+    Literal,  // a run of plain chars
+    AnyChar,  // `?`
+    AnyChars, // `*`
+    Class,    // `[abc]`, `[a-z]`, `[!a-z]`
+  };
+
+  class GlobToken
+  {
+    public: GlobTokenKind kind;
+    public: uint32_t      start;  // the chars of a literal inside `GlobSegment::chars`, or the index of a class
+    public: uint32_t      length;
+  };
+
+  // a set of bytes, one bit each
+  class GlobClass
+  {
+    public: uint32_t bits[8];
+
+    public: inline bool contains(char c) const
+    {
+      return bits[uint8_t(c) / 32] & (1u << (uint8_t(c) % 32));
+    }
+  };
+
+  // the pattern of a single path element, or `**` which matches any count of directories
+  class GlobSegment
+  {
+    public: std::vector<GlobToken> tokens;
+    public: std::string            chars;
+    public: bool                   isRecursive;
+  };
+
+  // a path pattern compiled once, then matched against each entry of a directory walk:
+  // the matching state of a directory is a set of segments (one bit each), each entry name moves it to the next set,
+  // so a walk never needs to rescan a directory or to backtrack through the path
+  class Glob
+  {
+    private: std::vector<GlobSegment> segments;
+    private: std::vector<GlobClass>   classes;
+
+    // the directory where the walk starts, made by the segments before the first wildcard (it ends with `/`)
+    public: std::string root;
+
+    // null when the pattern is valid
+    public: cstring_t compileError;
+
+    // `pattern` must be a full path
+    public: Glob(const std::string& pattern);
+
+    // returns true when the path has `*`, `?` or `[`, the other paths are used as they are
+    public: static bool hasWildcards(const std::string& path);
+
+    // the state before the root's entries
+    public: uint64_t getStartStates() const;
+
+    // the state after an entry named `name` (directories without their trailing `/`)
+    public: uint64_t step(uint64_t states, const char* name, uint64_t length) const;
+
+    // true when the entry reached with `states` matches the whole pattern
+    public: inline bool isMatch(uint64_t states) const
+    {
+      return states & (uint64_t(1) << segments.size());
+    }
+
+    // true when the entries of a directory reached with `states` can still match
+    public: inline bool canDescend(uint64_t states) const
+    {
+      return states & ((uint64_t(1) << segments.size()) - 1);
+    }
+
+    private: void compileSegment(const std::string& segment);
+
+    // `pattern` points after `[`, returns the length of the class (`]` included) or 0 when it's not terminated
+    private: uint64_t compileClass(const char* pattern, uint64_t length);
+
+    private: bool matchesSegment(const GlobSegment& segment, const char* name, uint64_t length) const;
+
+    // adds the segments after the `**` ones, which can match no directory at all
+    private: uint64_t closeStates(uint64_t states) const;
+  };
+}
\ No newline at end of file
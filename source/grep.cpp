@@ -0,0 +1,160 @@
+#include "grep.h"
+#include "walker.h"
+
+// returns the line terminator of `line` (or `end` when it's the last line)
+static const char* findLineEnd(const char* line, const char* end)
+{
+  auto lineEnd = (const char*)memchr(line, '\n', end - line);
+
+  return lineEnd ? lineEnd : end;
+}
+
+// `\r\n` terminated lines are printed and matched without `\r`
+static uint64_t lengthWithoutCarriageReturn(const char* line, const char* lineEnd)
+{
+  return lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - line - 1 : lineEnd - line;
+}
+
+NScript::Grep::Grep(cstring_t pattern)
+{
+  this->isLiteral    = !hasRegexMetachars(pattern);
+  this->compileError = nullptr;
+  this->output       = stdout;
+
+  if (isLiteral)
+    this->literal = LiteralMatcher(pattern);
+  else
+  {
+    this->regex        = Regex(pattern);
+    this->compileError = regex.compileError;
+  }
+}
+
+bool NScript::Grep::hasRegexMetachars(cstring_t pattern)
+{
+  return strpbrk(pattern, ".[]*+?^$()|\\") != nullptr;
+}
+
+bool NScript::Grep::matchesLine(const char* line, uint64_t length)
+{
+  return isLiteral ? literal.find(line, length) != nullptr : regex.matchesLine(line, length);
+}
+
+void NScript::Grep::printMatch(cstring_t displayedPath, uint64_t lineNumber, const char* line, uint64_t length)
+{
+  if (displayedPath)
+    fiprintf(output, "%s:%lu: %.*s\n", displayedPath, (unsigned long)lineNumber, int(length), line);
+  else
+    fiprintf(output, "%lu: %.*s\n", (unsigned long)lineNumber, int(length), line);
+}
+
+uint64_t NScript::Grep::searchBlock(const char* block, uint64_t length, uint64_t& lineNumber, cstring_t displayedPath)
+{
+  auto     end     = block + length;
+  auto     line    = block;
+  uint64_t matches = 0;
+
+  if (!isLiteral)
+  {
+    // the regex is matched line by line
+    while (line < end)
+    {
+      auto lineEnd = findLineEnd(line, end);
+      auto length  = lengthWithoutCarriageReturn(line, lineEnd);
+
+      if (regex.matchesLine(line, length))
+      {
+        printMatch(displayedPath, lineNumber, line, length);
+        matches++;
+      }
+
+      lineNumber++;
+      line = lineEnd + 1;
+    }
+
+    return matches;
+  }
+
+  // the literal is searched over the whole block, lines are only located around the occurrences
+  while (line < end)
+  {
+    auto occurrence = literal.find(line, end - line);
+
+    if (!occurrence)
+      break;
+
+    // counting the lines skipped to reach the occurrence
+    for (auto newline = findLineEnd(line, occurrence); newline < occurrence; newline = findLineEnd(line, occurrence))
+    {
+      line = newline + 1;
+      lineNumber++;
+    }
+
+    auto lineEnd = findLineEnd(occurrence, end);
+
+    printMatch(displayedPath, lineNumber, line, lengthWithoutCarriageReturn(line, lineEnd));
+    matches++;
+    lineNumber++;
+    line = lineEnd + 1;
+  }
+
+  // counting the lines after the last occurrence
+  for (; line < end; line = findLineEnd(line, end) + 1)
+    lineNumber++;
+
+  return matches;
+}
+
+uint64_t NScript::Grep::searchFile(FILE* file, cstring_t displayedPath)
+{
+  auto     scope      = AllocationScope(AllocationCategory::Io);
+  auto     buffer     = new char[grepBlockSize];
+  uint64_t carried    = 0;
+  uint64_t lineNumber = 1;
+  uint64_t matches    = 0;
+
+  while (true)
+  {
+    auto read   = fread(buffer + carried, 1, grepBlockSize - carried, file);
+    auto length = carried + read;
+    auto isOver = read < grepBlockSize - carried;
+
+    // the block stops after its last complete line, the partial one is carried to the next block
+    auto blockLength = length;
+
+    if (!isOver)
+      while (blockLength > 0 && buffer[blockLength - 1] != '\n')
+        blockLength--;
+
+    // a single line fills the whole buffer, it's split
+    if (blockLength == 0)
+      blockLength = length;
+
+    matches += searchBlock(buffer, blockLength, lineNumber, displayedPath);
+    carried  = length - blockLength;
+
+    if (isOver)
+      break;
+
+    memmove(buffer, buffer + blockLength, carried);
+  }
+
+  delete[] buffer;
+  return matches;
+}
+
+uint64_t NScript::Grep::searchDirectory(cstring_t path)
+{
+  auto     walker  = DirWalker(path);
+  uint64_t matches = 0;
+
+  while (walker.next())
+    if (walker.event == WalkEvent::File)
+      if (auto file = fopen(walker.getPath(), "rb"))
+      {
+        matches += searchFile(file, walker.getPath());
+        fclose(file);
+      }
+
+  return matches;
+}
\ No newline at end of file
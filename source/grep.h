@@ -0,0 +1,46 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+#include "regex.h"
+
+namespace NScript
+{
+  // files are searched one block at a time, lines longer than a block are split
+  const uint64_t grepBlockSize = 8192;
+
+  // searches a pattern in files and lines, the pattern is searched literally when it has no regex metachar
+  class Grep
+  {
+    private: bool           isLiteral;
+    private: LiteralMatcher literal;
+    private: Regex          regex;
+
+    // null when the pattern is valid
+    public: cstring_t compileError;
+
+    // where the matching lines are printed, stdout by default
+    public: FILE* output;
+
+    public: Grep(cstring_t pattern);
+
+    public: bool matchesLine(const char* line, uint64_t length);
+
+    // prints the matching lines of the file as `lineNo: text` (or `path:lineNo: text` when `displayedPath` is not null),
+    // returns the count of matching lines
+    public: uint64_t searchFile(FILE* file, cstring_t displayedPath);
+
+    // searches all the files inside the directory (ending with `/`) and its sub directories
+    public: uint64_t searchDirectory(cstring_t path);
+
+    // searches the complete lines of a block, `lineNumber` is the number of its first line and is moved past the block
+    private: uint64_t searchBlock(const char* block, uint64_t length, uint64_t& lineNumber, cstring_t displayedPath);
+
+    private: void printMatch(cstring_t displayedPath, uint64_t lineNumber, const char* line, uint64_t length);
+
+    private: static bool hasRegexMetachars(cstring_t pattern);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "input.h"
+
+bool NScript::InputLog::startRecording(const std::string& path)
+{
+  stop();
+
+  auto header = InputLogHeader { inputLogMagic, inputLogVersion };
+
+  file = fopen(path.c_str(), "wb");
+
+  if (!file)
+    return false;
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1)
+  {
+    fclose(file);
+    file = nullptr;
+    return false;
+  }
+
+  auto scope = AllocationScope(AllocationCategory::Io);
+
+  this->mode        = InputLogMode::Recording;
+  this->path        = path;
+  this->framesCount = 0;
+  this->isWritten   = true;
+
+  frames.clear();
+  frames.reserve(inputLogBatchFrames);
+  return true;
+}
+
+bool NScript::InputLog::startReplay(const std::string& path)
+{
+  stop();
+
+  auto scope = AllocationScope(AllocationCategory::Io);
+
+  if (!readRecording(path, frames))
+  {
+    frames.clear();
+    return false;
+  }
+
+  this->mode        = InputLogMode::Replaying;
+  this->path        = path;
+  this->framesCount = 0;
+  return true;
+}
+
+bool NScript::InputLog::stop()
+{
+  auto isStopped = true;
+
+  if (mode == InputLogMode::Recording)
+  {
+    isStopped = writeBatch() && isWritten;
+    isStopped = !fclose(file) && isStopped;
+    file      = nullptr;
+  }
+
+  mode = InputLogMode::Idle;
+  frames.clear();
+  return isStopped;
+}
+
+NScript::InputFrame NScript::InputLog::nextFrame(const InputFrame& liveInput)
+{
+  switch (mode)
+  {
+    case InputLogMode::Replaying:
+      // the live input takes over once the recording is over
+      if (framesCount < frames.size())
+        return frames[framesCount++];
+
+      stop();
+      return liveInput;
+
+    case InputLogMode::Recording:
+      framesCount++;
+      frames.push_back(liveInput);
+
+      if (frames.size() >= inputLogBatchFrames)
+        isWritten = writeBatch() && isWritten;
+
+      return liveInput;
+
+    default:
+      return liveInput;
+  }
+}
+
+bool NScript::InputLog::readRecording(const std::string& path, std::vector<InputFrame>& frames)
+{
+  auto file   = fopen(path.c_str(), "rb");
+  auto header = InputLogHeader();
+
+  if (!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+
+  uint64_t size = ftell(file);
+
+  fseek(file, 0, SEEK_SET);
+
+  // a frame cut in half means the recording was not stopped properly
+  auto isRecording = size >= sizeof(header) && (size - sizeof(header)) % sizeof(InputFrame) == 0 &&
+                     fread(&header, sizeof(header), 1, file) == 1 && header.magic == inputLogMagic && header.version == inputLogVersion;
+
+  if (isRecording)
+  {
+    frames.resize((size - sizeof(header)) / sizeof(InputFrame));
+    isRecording = fread(frames.data(), sizeof(InputFrame), frames.size(), file) == frames.size();
+  }
+
+  fclose(file);
+  return isRecording;
+}
+
+bool NScript::InputLog::writeBatch()
+{
+  auto isWritten = fwrite(frames.data(), sizeof(InputFrame), frames.size(), file) == frames.size();
+
+  frames.clear();
+  return isWritten;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // "NSI1" read as a little endian word
+  const uint32_t inputLogMagic   = 0x3149534E;
+  const uint32_t inputLogVersion = 1;
+
+  // the recorded frames are written in batches, so that the card is not accessed on every frame
+  const uint64_t inputLogBatchFrames = 256;
+
+  // the input read by the main loop in a frame
+  class InputFrame
+  {
+    public: int32_t  keyboardKey; // the key of the virtual keyboard (NOKEY when none)
+    public: uint32_t buttonKeys;  // the buttons pressed in this frame (keysDown)
+  };
+
+  // the recording is the header followed by a frame after the other, until the end of the file
+  class InputLogHeader
+  {
+    public: uint32_t magic;
+    public: uint32_t version;
+  };
+
+  enum class InputLogMode : uint8_t
+  {
+    Idle,
+    Recording,
+    Replaying,
+  };
+
+  // records the input of each frame to a file, or replays a recording in place of the real input
+  class InputLog
+  {
+    private: InputLogMode            mode;
+    private: FILE*                   file;        // the recording being written
+    private: std::string             path;
+    private: std::vector<InputFrame> frames;      // the batch not written yet, or the whole recording being replayed
+    private: uint64_t                framesCount; // how many frames were recorded or replayed so far
+    private: bool                    isWritten;   // false once a batch could not be written
+
+    public: InputLog()
+    {
+      this->mode        = InputLogMode::Idle;
+      this->file        = nullptr;
+      this->path        = std::string();
+      this->frames      = std::vector<InputFrame>();
+      this->framesCount = 0;
+      this->isWritten   = true;
+    }
+
+    public: inline InputLogMode getMode() const
+    {
+      return mode;
+    }
+
+    public: inline uint64_t getFramesCount() const
+    {
+      return framesCount;
+    }
+
+    public: inline const std::string& getPath() const
+    {
+      return path;
+    }
+
+    // returns false when the recording could not be created
+    public: bool startRecording(const std::string& path);
+
+    // loads the whole recording, returns false when it could not be read or it's not a recording
+    public: bool startReplay(const std::string& path);
+
+    // stops recording or replaying, returns false when the recording could not be written completely
+    public: bool stop();
+
+    // returns the input of the current frame: the recorded one while replaying (`liveInput` is ignored),
+    // otherwise `liveInput`, which is recorded while recording
+    public: InputFrame nextFrame(const InputFrame& liveInput);
+
+    // reads all the frames of a recording, returns false when it's not one
+    public: static bool readRecording(const std::string& path, std::vector<InputFrame>& frames);
+
+    // writes the frames of the batch, returns false on failure
+    private: bool writeBatch();
+  };
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "lazy.h"
+
+NScript::LazyPageCache& NScript::LazyPageCache::operator=(LazyPageCache&& other)
+{
+  if (this == &other)
+    return *this;
+
+  setMaxPages(0);
+
+  this->pages      = std::move(other.pages);
+  this->maxPages   = other.maxPages;
+  this->useClock   = other.useClock;
+  this->openedFile = other.openedFile;
+  this->opened     = other.opened;
+  this->generation = other.generation;
+
+  other.pages.clear();
+  other.openedFile = nullptr;
+  other.opened     = nullptr;
+
+  return *this;
+}
+
+void NScript::LazyPageCache::setMaxPages(uint64_t count)
+{
+  maxPages = count;
+
+  // the least recently used pages are freed first
+  while (pages.size() > maxPages)
+  {
+    auto oldest = std::min_element(pages.begin(), pages.end(), [] (const LazyPage& a, const LazyPage& b) { return a.lastUse < b.lastUse; });
+
+    delete[] oldest->data;
+    pages.erase(oldest);
+  }
+
+  if (maxPages == 0 && opened)
+  {
+    fclose(opened);
+
+    opened     = nullptr;
+    openedFile = nullptr;
+  }
+}
+
+void NScript::LazyPageCache::invalidate()
+{
+  generation++;
+
+  // the slots are kept allocated, they are the first to be reused
+  for (auto& page : pages)
+  {
+    page.file    = nullptr;
+    page.lastUse = 0;
+  }
+
+  if (opened)
+    fclose(opened);
+
+  opened     = nullptr;
+  openedFile = nullptr;
+}
+
+bool NScript::LazyPageCache::isChanged(LazyFile& file)
+{
+  if (file.checkedGeneration == generation)
+    return false;
+
+  struct stat info;
+
+  if (stat(file.path.c_str(), &info) || uint64_t(info.st_size) != file.size || info.st_mtime != file.modifiedTime)
+    return true;
+
+  file.checkedGeneration = generation;
+  return false;
+}
+
+bool NScript::LazyPageCache::openFile(const LazyFile& file)
+{
+  if (openedFile == &file)
+    return true;
+
+  if (opened)
+    fclose(opened);
+
+  opened     = fopen(file.path.c_str(), "rb");
+  openedFile = opened ? &file : nullptr;
+
+  return opened != nullptr;
+}
+
+const NScript::LazyPage* NScript::LazyPageCache::getPage(const LazyFile& file, uint64_t index)
+{
+  useClock++;
+
+  for (auto& page : pages)
+    if (page.file == &file && page.index == index)
+    {
+      page.lastUse = useClock;
+      return &page;
+    }
+
+  if (maxPages == 0 || !openFile(file))
+    return nullptr;
+
+  auto page = (LazyPage*)nullptr;
+
+  // a new slot is allocated until the cache is full, then the least recently used one is reused
+  if (pages.size() < maxPages)
+  {
+    auto scope = AllocationScope(AllocationCategory::Io);
+
+    pages.push_back((LazyPage) { .file = nullptr, .index = 0, .length = 0, .lastUse = 0, .data = new char[lazyPageSize] });
+    page = &pages.back();
+  }
+  else
+    page = &*std::min_element(pages.begin(), pages.end(), [] (const LazyPage& a, const LazyPage& b) { return a.lastUse < b.lastUse; });
+
+  // the page is not valid until it's loaded
+  page->file = nullptr;
+
+  if (fseek(opened, index * lazyPageSize, SEEK_SET))
+    return nullptr;
+
+  page->length  = fread(page->data, 1, lazyPageSize, opened);
+  page->file    = &file;
+  page->index   = index;
+  page->lastUse = useClock;
+
+  return page;
+}
+
+uint64_t NScript::LazyPageCache::read(const LazyFile& file, uint64_t offset, uint64_t length, char* destination)
+{
+  uint64_t copied = 0;
+
+  // the file may have shrunk after it was read, then the pages are shorter
+  while (copied < length && offset + copied < file.size)
+  {
+    auto position = offset + copied;
+    auto page     = getPage(file, position / lazyPageSize);
+
+    if (!page)
+      break;
+
+    auto pageOffset = position % lazyPageSize;
+
+    if (pageOffset >= page->length)
+      break;
+
+    auto count = std::min(std::min(page->length - pageOffset, length - copied), file.size - position);
+
+    memcpy(destination + copied, page->data + pageOffset, count);
+    copied += count;
+  }
+
+  return copied;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // files are loaded in pages of this size when a lazy string is accessed
+  const uint64_t lazyPageSize = 1024;
+
+  // how many pages the cache keeps in memory by default
+  const uint64_t defaultLazyPagesCount = 8;
+
+  // `read` returns a lazy string for the files which are at least this big
+  const uint64_t lazyReadThreshold = 4096;
+
+  // the content of a file which is loaded only when it's accessed, its size and modification time are taken when it's read
+  class LazyFile
+  {
+    public: std::string path;
+    public: uint64_t    size;
+    public: bool        isBinary;          // read in binary mode, it's loaded as bytes
+    public: time_t      modifiedTime;      // the file is considered changed when its time or its size differ
+    public: uint64_t    checkedGeneration; // the generation of the cache in which the file was last found unchanged
+
+    public: LazyFile(std::string path, uint64_t size, bool isBinary)
+    {
+      struct stat info;
+
+      this->path              = path;
+      this->size              = size;
+      this->isBinary          = isBinary;
+      this->modifiedTime      = stat(path.c_str(), &info) ? 0 : info.st_mtime;
+      this->checkedGeneration = UINT64_MAX;
+    }
+
+    // a file read earlier, with the time it had then
+    public: LazyFile(std::string path, uint64_t size, bool isBinary, time_t modifiedTime)
+    {
+      this->path              = path;
+      this->size              = size;
+      this->isBinary          = isBinary;
+      this->modifiedTime      = modifiedTime;
+      this->checkedGeneration = UINT64_MAX;
+    }
+  };
+
+  class LazyPage
+  {
+    public: const LazyFile* file;
+    public: uint64_t        index;   // the page starts at `index * lazyPageSize`
+    public: uint64_t        length;  // only the last page of a file can be shorter than lazyPageSize
+    public: uint64_t        lastUse; // the least recently used page is replaced first
+    public: char*           data;
+  };
+
+  // the pages of the lazy files which were accessed recently, shared by all of them
+  class LazyPageCache
+  {
+    private: std::vector<LazyPage> pages;
+    private: uint64_t              maxPages;
+    private: uint64_t              useClock;
+    private: const LazyFile*       openedFile; // only the file accessed last is kept open
+    private: FILE*                 opened;
+    private: uint64_t              generation; // bumped when some file may have been written, the lazy files are checked again then
+
+    public: LazyPageCache()
+    {
+      this->pages      = std::vector<LazyPage>();
+      this->maxPages   = defaultLazyPagesCount;
+      this->useClock   = 0;
+      this->openedFile = nullptr;
+      this->opened     = nullptr;
+      this->generation = 0;
+    }
+
+    // the cache owns its pages and its opened file, it can be moved but not copied
+    public: LazyPageCache(const LazyPageCache& other) = delete;
+
+    public: LazyPageCache& operator=(const LazyPageCache& other) = delete;
+
+    public: LazyPageCache(LazyPageCache&& other) : LazyPageCache()
+    {
+      *this = std::move(other);
+    }
+
+    // frees the pages of this cache before taking the ones of `other`, which is left empty
+    public: LazyPageCache& operator=(LazyPageCache&& other);
+
+    public: ~LazyPageCache()
+    {
+      setMaxPages(0);
+    }
+
+    // frees the pages over the new count (and closes the opened file when it's 0)
+    public: void setMaxPages(uint64_t count);
+
+    public: inline uint64_t getMaxPages()
+    {
+      return maxPages;
+    }
+
+    // drops all the pages, to be called when some file may have been written (their content may be stale)
+    public: void invalidate();
+
+    // returns true when the file was written (or removed) after it was read, it's checked only once for each generation
+    public: bool isChanged(LazyFile& file);
+
+    // copies `length` bytes of the file starting from `offset` into `destination`,
+    // returns how many were copied (less than `length` at the end of the file or when it could not be read)
+    public: uint64_t read(const LazyFile& file, uint64_t offset, uint64_t length, char* destination);
+
+    // returns the loaded page, or null when it could not be read
+    private: const LazyPage* getPage(const LazyFile& file, uint64_t index);
+
+    private: bool openFile(const LazyFile& file);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "lz77.h"
+
+bool NScript::Lz77Compressor::fill(FILE* source, uint64_t size)
+{
+  // the bytes which can still be referenced, or matched, are kept
+  auto consumed = dataStart + dataLength;
+  auto kept     = std::min(dataLength, lz77WindowSize + lz77MaxMatch);
+
+  memmove(data, data + dataLength - kept, kept);
+  dataStart  = consumed - kept;
+  dataLength = kept;
+
+  auto wanted = std::min(uint64_t(sizeof(data)) - kept, size - consumed);
+  auto read   = fread(data + kept, 1, wanted, source);
+
+  dataLength += read;
+  return read == wanted;
+}
+
+void NScript::Lz77Compressor::insert(uint64_t position)
+{
+  auto h = hash(position);
+
+  prev[position % lz77WindowSize] = head[h];
+  head[h]                         = uint32_t(position + 1);
+}
+
+uint64_t NScript::Lz77Compressor::findMatch(uint64_t position, uint64_t available, uint64_t& distance)
+{
+  auto     maxLength = std::min(available, lz77MaxMatch);
+  auto     current   = data + (position - dataStart);
+  auto     candidate = head[hash(position)];
+  uint64_t best      = 0;
+
+  for (uint64_t chain = 0; candidate != 0 && chain < lz77MaxChainSize; chain++)
+  {
+    auto c = uint64_t(candidate - 1);
+
+    // too far behind, the older ones are even farther
+    if (position - c > lz77WindowSize || c < dataStart)
+      break;
+
+    auto     earlier = data + (c - dataStart);
+    uint64_t length  = 0;
+
+    while (length < maxLength && earlier[length] == current[length])
+      length++;
+
+    if (length > best)
+    {
+      best     = length;
+      distance = position - c;
+
+      if (best == maxLength)
+        break;
+    }
+
+    // the slot was reused by a newer position, the chain ends here
+    auto next = prev[c % lz77WindowSize];
+
+    if (next == 0 || next - 1 >= c)
+      break;
+
+    candidate = next;
+  }
+
+  return best >= lz77MinMatch ? best : 0;
+}
+
+bool NScript::Lz77Compressor::writeItem(FILE* destination, bool isMatch, uint8_t first, uint8_t second)
+{
+  if (blockItems == 0)
+  {
+    block[0]    = 0;
+    blockLength = 1;
+  }
+
+  if (isMatch)
+  {
+    block[0]               |= 0x80 >> blockItems;
+    block[blockLength++]    = first;
+    block[blockLength++]    = second;
+  }
+  else
+    block[blockLength++] = first;
+
+  return ++blockItems < 8 || flushBlock(destination);
+}
+
+bool NScript::Lz77Compressor::flushBlock(FILE* destination)
+{
+  if (blockItems == 0)
+    return true;
+
+  written   += blockLength;
+  blockItems = 0;
+
+  return fwrite(block, 1, blockLength, destination) == blockLength;
+}
+
+bool NScript::Lz77Compressor::compress(FILE* source, uint64_t size, FILE* destination)
+{
+  uint8_t header[4] = { lz77Type, uint8_t(size), uint8_t(size >> 8), uint8_t(size >> 16) };
+
+  memset(head, 0, sizeof(head));
+  dataStart   = 0;
+  dataLength  = 0;
+  blockItems  = 0;
+  blockLength = 0;
+  written     = sizeof(header);
+
+  if (fwrite(header, 1, sizeof(header), destination) != sizeof(header))
+    return false;
+
+  for (uint64_t position = 0; position < size;)
+  {
+    // a full match must always be in the buffer
+    if (position + lz77MaxMatch > dataStart + dataLength && dataStart + dataLength < size && !fill(source, size))
+      return false;
+
+    auto     available = dataStart + dataLength - position;
+    uint64_t distance  = 0;
+    auto     length    = available >= lz77MinMatch ? findMatch(position, available, distance) : 0;
+
+    if (length == 0)
+    {
+      if (!writeItem(destination, false, data[position - dataStart], 0))
+        return false;
+
+      length = 1;
+    }
+    else if (!writeItem(destination, true, uint8_t((length - lz77MinMatch) << 4 | (distance - 1) >> 8), uint8_t(distance - 1)))
+      return false;
+
+    // the skipped positions can be matched later as well
+    for (auto end = position + length; position < end; position++)
+      if (dataStart + dataLength - position >= lz77MinMatch)
+        insert(position);
+  }
+
+  if (!flushBlock(destination))
+    return false;
+
+  // the bios reads the compressed data by words, so it's padded to 4 bytes
+  for (; written % 4 != 0; written++)
+    if (fputc(0, destination) == EOF)
+      return false;
+
+  return true;
+}
+
+bool NScript::readLz77Header(const uint8_t* source, uint64_t length, uint64_t& size)
+{
+  if (length < 4 || source[0] != lz77Type)
+    return false;
+
+  size = uint64_t(source[1]) | uint64_t(source[2]) << 8 | uint64_t(source[3]) << 16;
+  return true;
+}
+
+bool NScript::decompressLz77(const uint8_t* source, uint64_t length, uint8_t* destination)
+{
+  uint64_t size = 0;
+
+  if (!readLz77Header(source, length, size))
+    return false;
+
+#ifdef ARM9
+  swiDecompressLZSSWram((void*)source, destination);
+  return true;
+#else
+  uint64_t in  = 4;
+  uint64_t out = 0;
+
+  while (out < size)
+  {
+    if (in >= length)
+      return false;
+
+    auto flags = source[in++];
+
+    for (uint64_t i = 0; i < 8 && out < size; i++, flags <<= 1)
+    {
+      if (!(flags & 0x80))
+      {
+        if (in >= length)
+          return false;
+
+        destination[out++] = source[in++];
+        continue;
+      }
+
+      if (in + 1 >= length)
+        return false;
+
+      auto matchLength = uint64_t(source[in] >> 4) + lz77MinMatch;
+      auto distance    = (uint64_t(source[in] & 0xF) << 8 | source[in + 1]) + 1;
+
+      in += 2;
+
+      if (distance > out)
+        return false;
+
+      // the match may overlap the bytes it's producing
+      for (uint64_t j = 0; j < matchLength && out < size; j++, out++)
+        destination[out] = destination[out - distance];
+    }
+  }
+
+  return true;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // the format decompressed by the bios (`swiDecompressLZSSWram`):
+  // a 4 bytes header `0x10 | size << 8`, then groups of 8 items preceded by a flags byte (the highest bit is the first item),
+  // an item is either a literal byte (flag 0) or 2 bytes `length - 3 << 12 | distance - 1` read big endian (flag 1)
+  const uint8_t  lz77Type         = 0x10;
+  const uint64_t lz77WindowSize   = 4096;
+  const uint64_t lz77MinMatch     = 3;
+  const uint64_t lz77MaxMatch     = 18;
+  const uint64_t lz77MaxSize      = (1 << 24) - 1;
+
+  // the positions with the same hash of their first 3 bytes are chained, only this many of them are compared
+  const uint64_t lz77HashBits     = 12;
+  const uint64_t lz77MaxChainSize = 32;
+
+  // the source is read in chunks of this size, the last window (and a match) is kept before them
+  const uint64_t lz77ChunkSize    = 8192;
+
+  // compresses a file while reading it, the memory taken doesn't depend on the file size
+  class Lz77Compressor
+  {
+    private: uint8_t  data[lz77WindowSize + lz77MaxMatch + lz77ChunkSize];
+    private: uint32_t head[1 << lz77HashBits]; // the last position (+1) of each hash, 0 when there's none
+    private: uint32_t prev[lz77WindowSize];    // the previous position (+1) with the same hash, indexed by position
+    private: uint64_t dataStart;               // the position of `data[0]` in the source
+    private: uint64_t dataLength;
+    private: uint8_t  block[1 + 8 * 2];        // a flags byte and its items, written once it's complete
+    private: uint64_t blockLength;
+    private: uint64_t blockItems;
+    private: uint64_t written;
+
+    // writes `size` bytes of `source` (already opened at its start) compressed to `destination`,
+    // returns false when a file could not be read or written
+    public: bool compress(FILE* source, uint64_t size, FILE* destination);
+
+    // how many compressed bytes the last `compress` wrote
+    public: inline uint64_t getWrittenBytes()
+    {
+      return written;
+    }
+
+    // moves the last window to the start of `data` and reads the next chunk after it, returns false on a read error
+    private: bool fill(FILE* source, uint64_t size);
+
+    private: inline uint32_t hash(uint64_t position)
+    {
+      auto p = data + (position - dataStart);
+
+      return ((uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2]) * 2654435761u) >> (32 - lz77HashBits);
+    }
+
+    private: void insert(uint64_t position);
+
+    // returns the length of the longest match of the bytes at `position` (0 when it's shorter than lz77MinMatch)
+    private: uint64_t findMatch(uint64_t position, uint64_t available, uint64_t& distance);
+
+    private: bool writeItem(FILE* destination, bool isMatch, uint8_t first, uint8_t second);
+
+    private: bool flushBlock(FILE* destination);
+  };
+
+  // reads the size from the header of a compressed buffer, returns false when it's not in the bios lz77 format
+  bool readLz77Header(const uint8_t* source, uint64_t length, uint64_t& size);
+
+  // decompresses a whole compressed buffer (header included) into `destination`, which must be as big as the header says,
+  // on the ds the bios does it, returns false when the data is corrupted (it's trusted by the bios)
+  bool decompressLz77(const uint8_t* source, uint64_t length, uint8_t* destination);
+}
\ No newline at end of file
@@ -5,7 +5,6 @@
 
 #include <nds.h>
 #include <stdio.h>
-#include <fat.h>
 
 #include "basics.h"
 #include "console.h"
@@ -17,59 +16,50 @@ int main()
   PrintConsole printConsole;
   Keyboard     virtualKeyboard;
 
+  // the phases of the boot are printed by `boot()`
+  startBootTiming();
+
   // initialize video
   videoSetMode(MODE_0_2D);
   videoSetModeSub(MODE_0_2D);
+  markBootPhase("video");
   
   // initialize vram
   vramSetPrimaryBanks(VRAM_A_MAIN_BG, VRAM_B_MAIN_SPRITE, VRAM_C_SUB_BG, VRAM_D_SUB_SPRITE);
+  markBootPhase("vram");
 
   // initialize print console on top screen and virtual keyboard on sub screen
   consoleInit(&printConsole, 0, BgType_Text4bpp, BgSize_T_256x256, 2, 0, true, true);
+  markBootPhase("console");
   keyboardInit(&virtualKeyboard, 0, BgType_Text4bpp, BgSize_T_256x512, 14, 0, false, true);
-
-  // initializing fat32 library for file io (on desmume it's not supported)
-#ifndef DESMUME
-  if (!fatInitDefault())
-    panic("fat not initialized correctly");
-#endif
+  markBootPhase("keyboard");
 
   NDSConsole console(&printConsole, &virtualKeyboard);
 
   iprintf("Nintendo DS Console ARM9\n");
   console.printPromptPrefix();
+  markBootPhase("prompt");
  
+  auto timing = FrameTiming();
+
   for (uint64_t frame = 0; true; frame++)
   {
     // reading the pressed letter
     auto keyboardKey = keyboardUpdate();
 
-    // when virtual key is pressed
-    if (keyboardKey != NOKEY)
-      console.processVirtualKey(keyboardKey);
-    
     // updating the key state
     scanKeys();
 
-    // getting the last key state
-    auto buttonKey = keysDown();
-
-    // processing the physical button keys
-    switch (buttonKey)
-    {
-      case KEY_LEFT:  console.moveCursorIndex(MovingDirection2D::LeftOrUp);     break;
-      case KEY_RIGHT: console.moveCursorIndex(MovingDirection2D::RightOrDown);  break;
-      case KEY_UP:    console.moveRecentBuffer(MovingDirection2D::LeftOrUp);    break;
-      case KEY_DOWN:  console.moveRecentBuffer(MovingDirection2D::RightOrDown); break;
-      case KEY_B:     console.removeChar();                                     break;
-      case KEY_A:     console.returnPrompt();                                   break;
-      case KEY_X:     console.scrollScreen(MovingDirection2D::LeftOrUp);        break;
-      case KEY_Y:     console.scrollScreen(MovingDirection2D::RightOrDown);     break;
-    }
-
-    // printing the prompt
-    console.flushPromptBuffer(frame, true);
+    // the input of the frame is recorded or replaced by a recording, then processed along with the prompt
+    console.updateFrame(frame, (NScript::InputFrame) { .keyboardKey = keyboardKey, .buttonKeys = keysDown() }, timing);
     swiWaitForVBlank();
+
+    // the fat filesystem is mounted once the first prompt is on screen, unless a builtin needed it before
+    // (on desmume it's not supported)
+#ifndef DESMUME
+    if (frame == 0)
+      mountFilesystem();
+#endif
   }
 
   return 0;
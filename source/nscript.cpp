@@ -1,17 +1,59 @@
 #include "nscript.h"
+#include "stream.h"
+#include "walker.h"
+#include "astcache.h"
+#include "snapshot.h"
+#include "input.h"
+
+#include <errno.h>
+
+// all the powers of ten which are exactly representable by a float64
+static const float64 exactPowersOfTen[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// a null terminated string for each char, so that single char tokens don't need to be allocated
+class SingleCharStrings
+{
+  public: char strings[256][2];
+
+  public: constexpr SingleCharStrings() : strings()
+  {
+    for (uint64_t c = 0; c < 256; c++)
+      strings[c][0] = char(c);
+  }
+};
+
+// built at compile time, so it's only ever read (the evaluators of the host runner share it)
+static constexpr SingleCharStrings singleCharStrings = SingleCharStrings();
+
+static cstring_t singleCharString(char c)
+{
+  return singleCharStrings.strings[uint8_t(c)];
+}
 
-std::string NScript::Node::toString()
+std::string NScript::Node::toString() const
 {
   std::string temp;
 
   switch (kind)
   {
     case NodeKind::Num:         return cutTrailingZeros(std::to_string(value.num));
-    case NodeKind::String:      return "'" + Parser::escapedToEscapes(value.str) + "'";
-    case NodeKind::Bin:         return value.bin->left.toString() + " " + value.bin->op.toString() + " " + value.bin->right.toString();
-    case NodeKind::Una:         return value.una->op.toString() + value.una->term.toString();
+    case NodeKind::String:      return "'" + Lexer::escapedToEscapes(value.str) + "'";
+    case NodeKind::LazyString:  return "read('" + Lexer::escapedToEscapes(value.lazy->path) + "')";
+    case NodeKind::StringSlice:
+    case NodeKind::Bytes:       return "'" + Lexer::escapedToEscapes(std::string(value.slice->data, value.slice->length)) + "'";
+    case NodeKind::Bin:         return value.bin->left.toString() + " " + kindToString(value.bin->op) + " " + value.bin->right.toString();
+    case NodeKind::Una:         return kindToString(value.una->op) + value.una->term.toString();
     case NodeKind::Assign:      return value.assign->name.toString() + " = " + value.assign->expr.toString();
 
+    case NodeKind::Def:
+      return
+        "def " + value.def->name.toString() +
+        "(" + joinArray<Node>(", ", value.def->params, [] (Node param) { return param.toString(); }) + ") = " +
+        value.def->body.toString();
+
     case NodeKind::Call:
       return value.call->name.toString() + "(" + joinArray<Node>(", ", value.call->args, [] (Node arg) { return arg.toString(); }) + ")";
 
@@ -23,6 +65,7 @@ std::string NScript::Node::toString()
     case NodeKind::RPar:
     case NodeKind::Comma:
     case NodeKind::Eq:
+    case NodeKind::Pipe:
     case NodeKind::Bad:
     case NodeKind::None:
     case NodeKind::Identifier:  return value.str;
@@ -33,11 +76,18 @@ std::string NScript::Node::toString()
   return nullptr;
 }
 
-NScript::Node NScript::Parser::nextToken()
+NScript::Node NScript::Lexer::nextToken()
 {
   // eating all the whitespaces (they have no meaning)
   eatWhitespaces();
 
+  // longer expressions could not be located by the 16 bits positions
+  if (expression.length() > maxExpressionLength)
+  {
+    raise({"expression is longer than ", std::to_string(maxExpressionLength), " chars"}, Position());
+    return Node::eof(Position());
+  }
+
   if (eof())
     return Node::eof(curPos());
   
@@ -51,16 +101,16 @@ NScript::Node NScript::Parser::nextToken()
     t = collectNumToken();
   else if (c == '\'')
     t = collectStringToken();
-  else if (arrayContains({'+', '-', '*', '/', '(', ')', ',', '='}, c))
-    t = Node(NodeKind(c), (NodeValue) { .str = cstringRealloc(std::string(1, c).c_str()) }, curPos());
+  else if (arrayContains({'+', '-', '*', '/', '(', ')', ',', '=', '|'}, c))
+    t = Node(NodeKind(c), (NodeValue) { .str = singleCharString(c) }, curPos());
   else
-    t = Node::bad(cstringRealloc(std::string(1, c).c_str()), curPos());
+    t = Node::bad(singleCharString(c), curPos());
 
   exprIndex++;
   return t;
 }
 
-NScript::Node NScript::Parser::collectStringToken()
+NScript::Node NScript::Lexer::collectStringToken()
 {
   // eating first `'`
   exprIndex++;
@@ -77,45 +127,163 @@ NScript::Node NScript::Parser::collectStringToken()
   exprIndex++;
 
   if (eof())
-    throw Error({"unclosed string"}, Position(startPos, exprIndex));
+    return raise({"unclosed string"}, Position(startPos, exprIndex));
+
+  auto escaped = escapesToEscaped(seq, pos);
+
+  if (failed())
+    return Node::bad("<error>", pos);
+
+  // a plain string would end at the first null char, such a literal is bytes
+  if (escaped.find('\0') != std::string::npos)
+  {
+    auto data = new char[escaped.length() + 1];
 
-  return Node(NodeKind::String, (NodeValue) { .str = cstringRealloc(escapesToEscaped(seq, pos).c_str()) }, pos);
+    memcpy(data, escaped.c_str(), escaped.length() + 1);
+    return Node(NodeKind::Bytes, (NodeValue) { .slice = new StringSlice(data, escaped.length()) }, pos);
+  }
+
+  return Node(NodeKind::String, (NodeValue) { .str = cstringRealloc(escaped.c_str()) }, pos);
 }
 
-NScript::Node NScript::Parser::collectNumToken()
+NScript::Node NScript::Lexer::collectNumToken()
 {
-  auto startPos = exprIndex;
-  auto seq      = collectSequence([this] {
-    return isNumChar(curChar(), false);
-  });
-  auto pos      = Position(startPos, exprIndex + 1);
+  // hex (`0x..`) and binary (`0b..`) integer literals
+  if (curChar() == '0' && !eof(+1) && (curChar(+1) == 'x' || curChar(+1) == 'b'))
+    return collectRadixNumToken(curChar(+1) == 'x' ? 16 : 2);
+
+  auto     startPos    = exprIndex;
+  uint64_t mantissa    = 0;
+  int64_t  exponent    = 0;
+  uint64_t dotsCount   = 0;
+  bool     isTruncated = false;
+
+  // scanning the number straight from the expression, without collecting it into a string
+  while (!eof())
+  {
+    auto c = curChar();
+
+    if (isNumChar(c, true))
+    {
+      // the mantissa holds up to 19 digits, the next ones only move the exponent
+      if (mantissa < 1000000000000000000ull)
+      {
+        mantissa  = mantissa * 10 + uint64_t(c - '0');
+        exponent -= dotsCount > 0;
+      }
+      else
+      {
+        isTruncated |= c != '0';
+        exponent    += dotsCount == 0;
+      }
+    }
+    else if (c == '.')
+      dotsCount++;
+    // digit separators are only allowed between two digits (`1_000`)
+    else if (!isDigitSeparator(10))
+      break;
+
+    exprIndex++;
+  }
+
+  // going back to the last char of the number
+  exprIndex--;
+
+  auto pos = Position(startPos, exprIndex + 1);
 
   // inconsistent numbers like 0.0.1 or 1.2.3 etc
-  if (countOccurrences(seq, '.') > 1)
-    throw Error({"number cannot include more than one dot"}, pos);
+  if (dotsCount > 1)
+    return raise({"number cannot include more than one dot"}, pos);
   
   // when the user wrote something like 0. or 2. etc
-  if (seq[seq.length() - 1] == '.')
-    throw Error(
-      {"number cannot end with a dot (correction: `", seq.substr(0, seq.length() - 1), "`)"},
+  if (curChar() == '.')
+    return raise(
+      {"number cannot end with a dot (correction: `", expression.substr(startPos, pos.length() - 1), "`)"},
       pos
     );
   
   auto value = (NodeValue) {
-    .num = atof(seq.c_str())
+    .num = decimalToFloat64(mantissa, exponent, isTruncated, pos)
   };
 
   // when the next char is an identifier, the user wrote something like 123hello or 123_
   if (!eof(+1) && isIdentifierChar(curChar(+1), false))
-    throw Error(
-      {"number cannot include part of identifier (correction: `", seq, " ", std::string(1, curChar(+1)), "...`)"},
+    return raise(
+      {"number cannot include part of identifier (correction: `", expression.substr(startPos, pos.length()), " ", std::string(1, curChar(+1)), "...`)"},
       Position(pos.startPos, curPos(+1).endPos)
     );
 
   return Node(NodeKind::Num, value, pos);
 }
 
-NScript::Node NScript::Parser::convertToKeywordWhenPossible(Node token)
+NScript::Node NScript::Lexer::collectRadixNumToken(uint8_t radix)
+{
+  auto     startPos    = exprIndex;
+  uint64_t value       = 0;
+  uint64_t digitsCount = 0;
+  bool     isOverflow  = false;
+
+  // eating the `0x` or `0b` prefix
+  exprIndex += 2;
+
+  while (!eof())
+  {
+    auto digit = radixDigitValue(curChar());
+
+    if (digit < radix)
+    {
+      isOverflow |= value > (UINT64_MAX - digit) / radix;
+      value       = value * radix + digit;
+      digitsCount++;
+    }
+    else if (!isDigitSeparator(radix))
+      break;
+
+    exprIndex++;
+  }
+
+  // going back to the last char of the number
+  exprIndex--;
+
+  auto pos = Position(startPos, exprIndex + 1);
+
+  // when the user wrote only the prefix, like 0x or 0b
+  if (digitsCount == 0)
+    return raise({"expected digits after `", expression.substr(startPos, 2), "`"}, pos);
+  
+  if (isOverflow)
+    return raise({"number cannot be larger than 64 bits"}, pos);
+
+  // when the next char is an identifier, the user wrote something like 0xffz or 0b102
+  if (!eof(+1) && isIdentifierChar(curChar(+1), false))
+    return raise(
+      {"number cannot include part of identifier (correction: `", expression.substr(startPos, pos.length()), " ", std::string(1, curChar(+1)), "...`)"},
+      Position(pos.startPos, curPos(+1).endPos)
+    );
+
+  return Node(NodeKind::Num, (NodeValue) { .num = float64(value) }, pos);
+}
+
+float64 NScript::Lexer::decimalToFloat64(uint64_t mantissa, int64_t exponent, bool isTruncated, Position pos)
+{
+  // fast path (clinger): when both the mantissa and the power of ten are exactly representable,
+  // a single multiplication or division is already correctly rounded
+  if (!isTruncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    return exponent < 0
+      ? float64(mantissa) / exactPowersOfTen[-exponent]
+      : float64(mantissa) * exactPowersOfTen[exponent];
+
+  // slow path: numbers with more than 19 significant digits are rare, strtod rounds them correctly
+  auto digits = std::string();
+
+  for (auto i = pos.startPos; i < pos.endPos; i++)
+    if (expression[i] != '_')
+      digits.push_back(expression[i]);
+
+  return strtod(digits.c_str(), nullptr);
+}
+
+NScript::Node NScript::Lexer::convertToKeywordWhenPossible(Node token)
 {
   if (token.kind != NodeKind::Identifier)
    return token;
@@ -126,7 +294,7 @@ NScript::Node NScript::Parser::convertToKeywordWhenPossible(Node token)
   return token;
 }
 
-NScript::Node NScript::Parser::collectIdentifierToken()
+NScript::Node NScript::Lexer::collectIdentifierToken()
 {
   auto startPos = exprIndex;
   auto value    = (NodeValue) {
@@ -138,7 +306,7 @@ NScript::Node NScript::Parser::collectIdentifierToken()
   return Node(NodeKind::Identifier, value, Position(startPos, exprIndex + 1));
 }
 
-std::string NScript::Parser::collectSequence(std::function<bool()> checker)
+std::string NScript::Lexer::collectSequence(std::function<bool()> checker)
 {
   auto r = std::string();
 
@@ -155,17 +323,164 @@ std::string NScript::Parser::collectSequence(std::function<bool()> checker)
   return r;
 }
 
+bool NScript::Parser::lex(uint64_t maxTokens)
+{
+  auto scope = AllocationScope(AllocationCategory::Ast);
+
+  for (uint64_t i = 0; i < maxTokens && !isLexed(); i++)
+  {
+    tokens.push_back(lexer.nextToken());
+
+    // the error is raised only when the parser reaches the token, as if the lexer was called lazily
+    if (lexer.failed())
+    {
+      lexErrors.push_back(KeyPair<uint64_t, Error>(tokens.size() - 1, lexer.error));
+      lexer.clearError();
+    }
+  }
+
+  return isLexed();
+}
+
+void NScript::Parser::edit(std::string expression, uint64_t editedIndex)
+{
+  uint64_t keptCount = 0;
+
+  // keeping the tokens which end before the edit, including the char after them (the lexer looks ahead by one char),
+  // a token with a lexing error may have moved the lexer somewhere else, so it is collected again as well
+  while (
+    keptCount < tokens.size() &&
+    tokens[keptCount].kind != NodeKind::Eof &&
+    tokens[keptCount].pos.endPos < editedIndex &&
+    !(lexErrors.size() > 0 && lexErrors[0].key == keptCount)
+  )
+    keptCount++;
+
+  // freeing the strings of the dropped tokens, nothing was evaluated from them yet
+  for (uint64_t i = keptCount; i < tokens.size(); i++)
+    if (tokens[i].kind == NodeKind::Identifier || tokens[i].kind == NodeKind::None || tokens[i].kind == NodeKind::String)
+      delete [] tokens[i].value.str;
+    else if (tokens[i].kind == NodeKind::Bytes)
+    {
+      delete [] tokens[i].value.slice->data;
+      delete tokens[i].value.slice;
+    }
+
+  tokens.resize(keptCount);
+  lexErrors.erase(
+    std::remove_if(lexErrors.begin(), lexErrors.end(), [keptCount] (const KeyPair<uint64_t, Error>& e) { return e.key >= keptCount; }),
+    lexErrors.end()
+  );
+
+  // each kept token ends exactly where the lexer stopped after collecting it
+  lexer.restart(expression, keptCount > 0 ? tokens.back().pos.endPos : 0);
+}
+
+void NScript::Parser::deleteTree(const Node& tree)
+{
+  switch (tree.kind)
+  {
+    case NodeKind::Bin:
+      deleteTree(tree.value.bin->left);
+      deleteTree(tree.value.bin->right);
+      delete tree.value.bin;
+      break;
+
+    case NodeKind::Una:
+      deleteTree(tree.value.una->term);
+      delete tree.value.una;
+      break;
+
+    case NodeKind::Call:
+      for (const auto& arg : tree.value.call->args)
+        deleteTree(arg);
+
+      delete tree.value.call;
+      break;
+
+    case NodeKind::Assign:
+      deleteTree(tree.value.assign->expr);
+      delete tree.value.assign;
+      break;
+
+    case NodeKind::Def:
+      deleteTree(tree.value.def->body);
+      delete tree.value.def;
+      break;
+
+    default:
+      break;
+  }
+}
+
+NScript::Node NScript::Parser::cloneTree(const Node& tree)
+{
+  auto clone = tree;
+
+  switch (tree.kind)
+  {
+    case NodeKind::Bin:
+      clone.value.bin = new BinNode(cloneTree(tree.value.bin->left), cloneTree(tree.value.bin->right), tree.value.bin->op, tree.value.bin->opPos);
+      break;
+
+    case NodeKind::Una:
+      clone.value.una = new UnaNode(cloneTree(tree.value.una->term), tree.value.una->op);
+      break;
+
+    case NodeKind::Call:
+      clone.value.call = new CallNode(tree.value.call->name, {});
+
+      for (const auto& arg : tree.value.call->args)
+        clone.value.call->args.push_back(cloneTree(arg));
+
+      break;
+
+    case NodeKind::Assign:
+      clone.value.assign = new AssignNode(tree.value.assign->name, cloneTree(tree.value.assign->expr));
+      break;
+
+    case NodeKind::Def:
+      clone.value.def = new DefNode(tree.value.def->name, tree.value.def->params, cloneTree(tree.value.def->body), tree.value.def->source);
+      break;
+
+    default:
+      break;
+  }
+
+  return clone;
+}
+
+NScript::Node NScript::Parser::advance()
+{
+  prevToken = curToken;
+  curToken  = tokens[tokenIndex];
+
+  // raising the lexing error of this token, if any
+  for (const auto& e : lexErrors)
+    if (e.key == tokenIndex)
+      raise(e.val.message, e.val.position);
+
+  // the last token (eof) is returned forever
+  if (tokenIndex < tokens.size() - 1)
+    tokenIndex++;
+
+  return curToken;
+}
+
 NScript::Node NScript::Parser::expectBinaryOrTerm(std::function<Node()> expector, std::vector<NodeKind> operators)
 {
   auto left = expector();
 
   // as long as matches one of the required operators, collects the right value and replaces the left one with a BinNode
-  while (!eofToken() && arrayContains(operators, curToken.kind))
+  while (!failed() && !eofToken() && arrayContains(operators, curToken.kind))
   {
     auto op = getCurAndAdvance();
     auto right = expector();
 
-    left = Node(NodeKind::Bin, (NodeValue) { .bin = new BinNode(left, right, op) }, Position(left.pos.startPos, right.pos.endPos));
+    if (failed())
+      return right;
+
+    left = Node(NodeKind::Bin, (NodeValue) { .bin = new BinNode(left, right, op.kind, op.pos) }, Position(left.pos.startPos, right.pos.endPos));
   }
 
   return left;
@@ -178,10 +493,18 @@ NScript::Node NScript::Parser::expectTerm()
 
   switch (getCurAndAdvance().kind)
   {
-    // simple token
+    // `def` is a keyword only when it's followed by the function's name
     case NodeKind::Identifier:
+      if (!strcmp(prevToken.value.str, "def") && curToken.kind == NodeKind::Identifier)
+        return collectDefNode();
+
+      term = prevToken;
+      break;
+
+    // simple token
     case NodeKind::Num:
     case NodeKind::String:
+    case NodeKind::Bytes:
     case NodeKind::None:
       term = prevToken;
       break;
@@ -191,18 +514,29 @@ NScript::Node NScript::Parser::expectTerm()
     case NodeKind::Minus:
       op   = prevToken;
       term = expectTerm();
-      term = Node(NodeKind::Una, (NodeValue) { .una = new UnaNode(term, op) }, Position(op.pos.startPos, term.pos.endPos));
+
+      if (failed())
+        return term;
+
+      term = Node(NodeKind::Una, (NodeValue) { .una = new UnaNode(term, op.kind) }, Position(op.pos.startPos, term.pos.endPos));
       break;
     
     case NodeKind::LPar:
       term = expectExpression();
+
+      if (failed())
+        return term;
+
       expectTokenAndAdvance(NodeKind::RPar);
       break;
     
     default:
-      throw Error({"unexpected token (found `", prevToken.toString(), "`)"}, prevToken.pos);
+      return raise({"unexpected token (found `", prevToken.toString(), "`)"}, prevToken.pos);
   }
 
+  if (failed())
+    return term;
+
   if (curToken.kind == NodeKind::LPar)
     term = collectCallNode(term);
   else if (curToken.kind == NodeKind::Eq)
@@ -214,19 +548,67 @@ NScript::Node NScript::Parser::expectTerm()
 NScript::Node NScript::Parser::collectAssignNode(Node name)
 {
   if (name.kind != NodeKind::Identifier)
-    throw Error({"expected an identifier when assigning"}, name.pos);
+    return raise({"expected an identifier when assigning"}, name.pos);
 
   // eating `=`
   advance();
   auto expr = expectExpression();
 
+  if (failed())
+    return expr;
+
   return Node(NodeKind::Assign, (NodeValue) { .assign = new AssignNode(name, expr) }, Position(name.pos.startPos, expr.pos.endPos));
 }
 
+NScript::Node NScript::Parser::collectDefNode()
+{
+  auto startPos = prevToken.pos.startPos;
+  auto name     = getCurAndAdvance();
+  auto params   = std::vector<Node>();
+
+  expectTokenAndAdvance(NodeKind::LPar);
+
+  while (!failed() && curToken.kind != NodeKind::RPar)
+  {
+    // when this is not the first param
+    if (params.size() > 0)
+      expectTokenAndAdvance(NodeKind::Comma);
+
+    if (failed())
+      break;
+
+    if (curToken.kind != NodeKind::Identifier)
+      return raise({"expected a parameter name (found `", curToken.toString(), "`)"}, curToken.pos);
+
+    // the lookup of a param takes the first match, so a second one with the same name could never be read
+    for (const auto& param : params)
+      if (!strcmp(param.value.str, curToken.value.str))
+        return raise({"parameter `", curToken.value.str, "` is declared twice"}, curToken.pos);
+
+    params.push_back(getCurAndAdvance());
+  }
+
+  // eating `)` and `=`
+  expectTokenAndAdvance(NodeKind::RPar);
+  expectTokenAndAdvance(NodeKind::Eq);
+
+  if (failed())
+    return Node::bad("<error>", Position(startPos, prevToken.pos.endPos));
+
+  auto body = expectExpression();
+
+  if (failed())
+    return body;
+
+  auto pos = Position(startPos, body.pos.endPos);
+
+  return Node(NodeKind::Def, (NodeValue) { .def = new DefNode(name, params, body, lexer.getText(pos)) }, pos);
+}
+
 NScript::Node NScript::Parser::collectCallNode(Node name)
 {
   if (name.kind != NodeKind::Identifier && name.kind != NodeKind::String)
-    throw Error({"expected string or identifier call name"}, name.pos);
+    return raise({"expected string or identifier call name"}, name.pos);
   
   auto startPos = curToken.pos.startPos;
   auto args     = std::vector<Node>();
@@ -234,10 +616,10 @@ NScript::Node NScript::Parser::collectCallNode(Node name)
   // eating first `(`
   advance();
 
-  while (true)
+  while (!failed())
   {
     if (eofToken())
-      throw Error({"unclosed call parameters list"}, Position(startPos, prevToken.pos.endPos));
+      return raise({"unclosed call parameters list"}, Position(startPos, prevToken.pos.endPos));
     
     if (curToken.kind == NodeKind::RPar)
     {
@@ -252,14 +634,28 @@ NScript::Node NScript::Parser::collectCallNode(Node name)
     
     args.push_back(expectExpression());
   }
+
+  return Node::bad("<error>", Position(startPos, prevToken.pos.endPos));
 }
 
-std::string NScript::Parser::escapesToEscaped(std::string s, Position pos)
+std::string NScript::Lexer::escapesToEscaped(std::string s, Position pos)
 {
   std::string t;
 
   for (uint64_t i = 0; i < s.length(); i++)
-    if (s[i] == '\\')
+    if (s[i] == '\\' && s[i + 1] == 'x')
+    {
+      // `\x` is followed by exactly two hex digits
+      auto high = i + 2 < s.length() ? radixDigitValue(s[i + 2]) : 255;
+      auto low  = i + 3 < s.length() ? radixDigitValue(s[i + 3]) : 255;
+
+      if (high >= 16 || low >= 16)
+        raise({"expected two hex digits after `\\x`"}, Position(pos.startPos + i + 1, pos.startPos + i + 3));
+
+      t.push_back(char(high << 4 | low));
+      i += 3;
+    }
+    else if (s[i] == '\\')
     {
       t.push_back(escapeChar(s[i + 1], Position(pos.startPos + i, pos.startPos + i + 1)));
 
@@ -272,103 +668,390 @@ std::string NScript::Parser::escapesToEscaped(std::string s, Position pos)
   return t;
 }
 
-NScript::Node NScript::Evaluator::expectType(Node node, NodeKind type)
+// keep in sync with evaluateCall
+static cstring_t builtinNames[] = {
+  "print", "floor", "cd", "clear", "shutdown", "ls", "rmdir", "mkdir", "rmfile", "write", "read", "grep", "find", "du", "copy", "move", "tail", "hexdump", "mem", "budget", "pagecache",
+  "save", "load", "boot", "dryrun", "compress", "decompress", "record", "replay",
+  "crc32", "crc16", "hash", "crc32s", "crc16s", "hashs",
+  "len", "slice", "split", "replace", "upper", "lower", "trim",
+  // pipeline stages
+  "filter", "head",
+};
+
+// the builtins which access the filesystem, it's mounted the first time one of them is called
+// (`shutdown` mounts it on its own, it powers off even without it)
+static cstring_t filesystemBuiltinNames[] = {
+  "cd", "ls", "rmdir", "mkdir", "rmfile", "write", "read", "grep", "du", "copy", "move", "head", "tail", "hexdump", "save", "load", "compress", "decompress",
+  "record", "replay",
+};
+
+// the builtins which access the filesystem only in their path form (a single arg),
+// `find(s, needle)` works on strings even without a card
+static cstring_t pathFormBuiltinNames[] = {
+  "find",
+};
+
+// the builtins which may write or remove files, the lazy strings check their files again after them
+static cstring_t fileWritingBuiltinNames[] = {
+  "rmdir", "rmfile", "write", "copy", "move", "compress", "decompress", "save",
+};
+
+static bool isFileWritingBuiltin(cstring_t name)
+{
+  for (const auto& builtinName : fileWritingBuiltinNames)
+    if (!strcmp(builtinName, name))
+      return true;
+
+  return false;
+}
+
+static bool isFilesystemCall(const NScript::CallNode& call)
+{
+  auto name = call.name.value.str;
+
+  for (const auto& builtinName : filesystemBuiltinNames)
+    if (!strcmp(builtinName, name))
+      return true;
+
+  for (const auto& builtinName : pathFormBuiltinNames)
+    if (!strcmp(builtinName, name))
+      return call.args.size() == 1;
+
+  return false;
+}
+
+bool NScript::Evaluator::isBuiltin(cstring_t name)
+{
+  for (const auto& builtinName : builtinNames)
+    if (!strcmp(builtinName, name))
+      return true;
+
+  return false;
+}
+
+NScript::Node NScript::Evaluator::expectType(const Node& node, NodeKind type)
 {
-  if (node.kind != type)
-    throw Error({"expected a value with type `", Node::kindToString(type), "` (found `", Node::kindToString(node.kind), "`)"}, node.pos);
+  // lazy strings and slices are copied only where a plain string is needed (binary ones become bytes)
+  auto value = (node.kind == NodeKind::LazyString || node.kind == NodeKind::StringSlice) && type == NodeKind::String ? materialize(node) : node;
+
+  if (failed())
+    return value;
+
+  if (value.kind != type)
+    return raise({"expected a value with type `", Node::kindToString(type), "` (found `", Node::kindToString(value.kind), "`)"}, value.pos);
   
-  return node;
+  return value;
+}
+
+NScript::Node NScript::Evaluator::expectCount(const Node& node)
+{
+  auto value = expectType(node, NodeKind::Num);
+
+  if (failed())
+    return value;
+
+  // counts, offsets and lengths are used unsigned, a negative one would become huge
+  if (value.value.num < 0)
+    return raise({"expected a count which is not negative (found `", value.toString(), "`)"}, value.pos);
+
+  return value;
 }
 
-void NScript::Evaluator::expectArgsCount(CallNode call, uint64_t count)
+void NScript::Evaluator::expectArgsCount(const CallNode& call, uint64_t count)
 {
   if (call.args.size() != count)
-    throw Error({"expected `", std::to_string(count), "` args (found `", std::to_string(call.args.size()), "`)"}, call.name.pos);
+    raise({"expected `", std::to_string(count), "` args (found `", std::to_string(call.args.size()), "`)"}, call.name.pos);
 }
 
-NScript::Node NScript::Evaluator::builtinFloor(CallNode call)
+NScript::Node NScript::Evaluator::builtinFloor(const CallNode& call)
 {
   expectArgsCount(call, 1);
 
+  if (failed())
+    return Node::none(call.name.pos);
+
   // truncating the float value
   auto expr = expectType(evaluateNode(call.args[0]), NodeKind::Num);
+
+  if (failed())
+    return expr;
+
   expr.value.num = uint64_t(expr.value.num);
 
   return expr;
 }
 
-void NScript::Evaluator::builtinPrint(CallNode call)
+void NScript::Evaluator::builtinPrint(const CallNode& call)
 {
-  // printing all arguments without separation and flushing
-  for (auto arg : call.args)
-    iprintf("%s", arg.toString().c_str());
+  // printing all arguments without separation and flushing, strings are printed as they are
+  for (const auto& arg : call.args)
+  {
+    auto value = evaluateNode(arg);
+
+    if (failed())
+      return;
+
+    if (isStringKind(value.kind))
+      writeString(value, output);
+    else
+      fiprintf(output, "%s", value.toString().c_str());
+  }
   
-  fflush(stdout);
+  fflush(output);
 }
 
-NScript::Node NScript::Evaluator::evaluateCallProcess(CallNode call, Position pos)
+NScript::Node NScript::Evaluator::evaluateCallProcess(const CallNode& call, Position pos)
 {
-  auto processPath = cstringRealloc(getFullPath(expectNonEmptyStringAndGetString(call.name), true).c_str());
+#ifndef ARM9
+  // the process would replace the host runner with all its scripts
+  return raise({"processes can't be run on the host"}, call.name.pos);
+#endif
+
+  auto processPath = getFullPath(expectNonEmptyStringAndGetString(call.name), true);
+
+  if (failed() || !expectFilesystem(call.name.pos))
+    return Node::none(pos);
+
   auto processArgv = new char*[call.args.size() + 2];
 
-  processArgv[0] = (char*)processPath;
+  processArgv[0] = (char*)processPath.c_str();
 
-  for (uint64_t i = 1; i < call.args.size(); i++)
-    processArgv[i] = (char*)cstringRealloc(expectStringLengthAndGetString(evaluateNode(call.args[i]), [] (uint64_t l) { return true; }).c_str());
+  // evaluated strings are never freed, so the args can point to them directly
+  for (uint64_t i = 0; i < call.args.size() && !failed(); i++)
+    processArgv[i + 1] = (char*)expectStringLengthAndGetString(evaluateNode(call.args[i]), [] (uint64_t l) { return true; });
   
-  processArgv[call.args.size()] = (char*)nullptr;
-
-  auto result = Node(NodeKind::Num, (NodeValue) { .num = float64(execv(processPath, processArgv)) }, pos);
+  processArgv[call.args.size() + 1] = (char*)nullptr;
 
-  // freeing all args including processPath, which is the first arg
-  for (uint64_t i = 0; i < call.args.size(); i++)
-    delete [] processArgv[i];
+  auto result = failed()
+    ? Node::none(pos)
+    : Node(NodeKind::Num, (NodeValue) { .num = float64(execv(processPath.c_str(), processArgv)) }, pos);
 
-  return ;
+  delete [] processArgv;
+  return result;
 }
 
-NScript::Node NScript::Evaluator::evaluateCall(CallNode call, Position pos)
+NScript::Node NScript::Evaluator::evaluateCall(const CallNode& call, Position pos)
 {
   // when the call's name is a string, searches for a process with that filename
   if (call.name.kind == NodeKind::String)
     return evaluateCallProcess(call, pos);
   
-  // otherwise searches for a builtin function with that name
-  auto name = std::string(call.name.value.str);
+  auto name = call.name.value.str;
+
+  // user functions can't shadow the builtins, so they are searched first
+  for (const auto& function : functions)
+    if (function.key == name)
+      return evaluateCallFunction(*function.val.value.def, call, pos);
+
+  if (isFilesystemCall(call) && !expectFilesystem(call.name.pos))
+    return Node::none(pos);
+
+  if (isFileWritingBuiltin(name))
+    pageCache.invalidate();
 
-  if (name == "print")
+  // otherwise searches for a builtin function with that name
+  if (!strcmp(name, "print"))
     builtinPrint(call);
-  else if (name == "floor")
+  else if (!strcmp(name, "floor"))
     return builtinFloor(call);
-  else if (name == "cd")
+  else if (!strcmp(name, "cd"))
     builtinCd(call);
-  else if (name == "clear")
+  else if (!strcmp(name, "clear"))
     builtinClear(call);
-  else if (name == "shutdown")
+  else if (!strcmp(name, "shutdown"))
     builtinShutdown(call);
-  else if (name == "ls")
+  else if (!strcmp(name, "ls"))
     builtinLs(call);
-  else if (name == "rmdir")
+  else if (!strcmp(name, "rmdir"))
     builtinRmDir(call);
-  else if (name == "mkdir")
+  else if (!strcmp(name, "mkdir"))
     builtinMkDir(call);
-  else if (name == "rmfile")
+  else if (!strcmp(name, "rmfile"))
     builtinRmFile(call);
-  else if (name == "write")
+  else if (!strcmp(name, "write"))
     builtinWrite(call);
-  else if (name == "read")
+  else if (!strcmp(name, "read"))
     return builtinRead(call, pos);
+  else if (!strcmp(name, "grep"))
+    builtinGrep(call);
+  else if (!strcmp(name, "find"))
+  {
+    // `find(s, needle)` searches inside a string, `find(pattern)` searches the files
+    if (call.args.size() == 2)
+      return builtinStringFind(call, pos);
+
+    builtinFind(call);
+  }
+  else if (!strcmp(name, "len"))
+    return builtinLen(call, pos);
+  else if (!strcmp(name, "slice"))
+    return builtinSlice(call, pos);
+  else if (!strcmp(name, "split"))
+    return builtinSplit(call, pos);
+  else if (!strcmp(name, "replace"))
+    return builtinReplace(call, pos);
+  else if (!strcmp(name, "upper"))
+    return builtinChangeCase(call, pos, true);
+  else if (!strcmp(name, "lower"))
+    return builtinChangeCase(call, pos, false);
+  else if (!strcmp(name, "trim"))
+    return builtinTrim(call, pos);
+  else if (!strcmp(name, "du"))
+    return builtinDu(call, pos);
+  else if (!strcmp(name, "head"))
+    builtinHead(call);
+  else if (!strcmp(name, "tail"))
+    builtinTail(call);
+  else if (!strcmp(name, "hexdump"))
+    builtinHexdump(call);
+  else if (!strcmp(name, "compress"))
+    builtinCompress(call);
+  else if (!strcmp(name, "decompress"))
+    return builtinDecompress(call, pos);
+  else if (!strcmp(name, "crc32"))
+    return builtinChecksum(call, pos, ChecksumKind::Crc32, false);
+  else if (!strcmp(name, "crc16"))
+    return builtinChecksum(call, pos, ChecksumKind::Crc16, false);
+  else if (!strcmp(name, "hash"))
+    return builtinChecksum(call, pos, ChecksumKind::Hash, false);
+  else if (!strcmp(name, "crc32s"))
+    return builtinChecksum(call, pos, ChecksumKind::Crc32, true);
+  else if (!strcmp(name, "crc16s"))
+    return builtinChecksum(call, pos, ChecksumKind::Crc16, true);
+  else if (!strcmp(name, "hashs"))
+    return builtinChecksum(call, pos, ChecksumKind::Hash, true);
+  else if (!strcmp(name, "mem"))
+    builtinMem(call);
+  else if (!strcmp(name, "budget"))
+    builtinBudget(call);
+  else if (!strcmp(name, "boot"))
+    builtinBoot(call);
+  else if (!strcmp(name, "dryrun"))
+    builtinDryRun(call);
+  else if (!strcmp(name, "pagecache"))
+    builtinPageCache(call);
+  else if (!strcmp(name, "save"))
+    builtinSave(call);
+  else if (!strcmp(name, "load"))
+    builtinLoad(call);
+  else if (!strcmp(name, "record"))
+    builtinRecord(call);
+  else if (!strcmp(name, "replay"))
+    builtinReplay(call);
+  else if (!strcmp(name, "copy"))
+    builtinCopy(call);
+  else if (!strcmp(name, "move"))
+    builtinMove(call);
   else
-    throw Error({"unknown builtin function"}, call.name.pos);
+    return raise({"unknown builtin function"}, call.name.pos);
   
   return Node::none(pos);
 }
 
-NScript::Node NScript::Evaluator::evaluateAssign(AssignNode assign, Position pos)
+NScript::Node NScript::Evaluator::evaluateCallFunction(const DefNode& function, const CallNode& call, Position pos)
+{
+  expectArgsCount(call, function.params.size());
+
+  if (failed())
+    return Node::none(pos);
+
+  if (callDepth >= maxCallDepth)
+    return raise({"stack limit reached (more than `", std::to_string(maxCallDepth), "` nested calls)"}, pos);
+
+  if (frames.size() + call.args.size() > maxFrameSlots)
+    return raise({"stack limit reached (the nested calls take more than `", std::to_string(maxFrameSlots), "` argument slots)"}, pos);
+
+  // the slots are reserved once, so that calls never allocate
+  if (frames.capacity() < maxFrameSlots)
+    frames.reserve(maxFrameSlots);
+
+  // the args are evaluated in the caller's frame and pushed after it
+  auto newFrameBase = frames.size();
+
+  for (const auto& arg : call.args)
+  {
+    auto value = evaluateNode(arg);
+
+    if (failed())
+    {
+      frames.resize(newFrameBase);
+      return value;
+    }
+
+    frames.push_back(value);
+  }
+
+  auto callerFunction  = currentFunction;
+  auto callerFrameBase = frameBase;
+
+  currentFunction = &function;
+  frameBase       = newFrameBase;
+  callDepth++;
+
+  auto result = evaluateNode(function.body);
+
+  // popping the frame
+  callDepth--;
+  frameBase       = callerFrameBase;
+  currentFunction = callerFunction;
+  frames.resize(newFrameBase);
+
+  // the body's spans point into the prompt which defined the function, so the error is moved on the call
+  if (failed())
+    error.position = pos;
+
+  // no body is being evaluated anymore, the redefined functions can be freed
+  if (callDepth == 0)
+  {
+    for (auto& retired : retiredDefs)
+      Parser::deleteTree(retired);
+
+    retiredDefs.clear();
+  }
+
+  return result;
+}
+
+NScript::Node NScript::Evaluator::evaluateDef(const DefNode& def, Position pos)
+{
+  auto name = def.name.value.str;
+
+  if (isBuiltin(name))
+    return raise({"`", name, "` is a builtin function"}, def.name.pos);
+
+  // the parsed tree is freed after the prompt, the function keeps its own copy
+  auto scope    = AllocationScope(AllocationCategory::Variables);
+  auto function = Parser::cloneTree(Node(NodeKind::Def, (NodeValue) { .def = (DefNode*)&def }, pos));
+
+  for (auto& f : functions)
+    if (f.key == name)
+    {
+      // the function is already declared (frees the old copy), when it's redefined by a body the old copy
+      // may be the one being evaluated, so it's freed only once the calls return
+      if (callDepth > 0)
+        retiredDefs.push_back(f.val);
+      else
+        Parser::deleteTree(f.val);
+
+      f.val = function;
+      return Node::none(pos);
+    }
+
+  functions.push_back(KeyPair<std::string, Node>(std::string(name), function));
+  return Node::none(pos);
+}
+
+NScript::Node NScript::Evaluator::evaluateAssign(const AssignNode& assign, Position pos)
 {
-  auto name = std::string(assign.name.value.str);
+  auto name = assign.name.value.str;
   auto expr = evaluateNode(assign.expr);
 
+  // the variable is left untouched when its value could not be evaluated
+  if (failed())
+    return expr;
+
+  auto scope = AllocationScope(AllocationCategory::Variables);
+
   for (uint64_t i = 0; i < map.size(); i++)
     if (map[i].key == name)
     {
@@ -378,29 +1061,53 @@ NScript::Node NScript::Evaluator::evaluateAssign(AssignNode assign, Position pos
     }
 
   // the variable is not declared yet (appends a new definition)
-  map.push_back(KeyPair<std::string, Node>(name, expr));
+  map.push_back(KeyPair<std::string, Node>(std::string(name), expr));
   return Node::none(pos);
 }
 
-NScript::Node NScript::Evaluator::evaluateUna(UnaNode una)
+NScript::Node NScript::Evaluator::evaluateUna(const UnaNode& una)
 {
   auto term = evaluateNode(una.term);
 
+  if (failed())
+    return term;
+
   // unary can only be applied to numbers
   if (term.kind != NodeKind::Num)
-    throw Error({"type `", Node::kindToString(term.kind), "` does not support unary `", Node::kindToString(una.op.kind), "`"}, term.pos);
+    return raise({"type `", Node::kindToString(term.kind), "` does not support unary `", Node::kindToString(una.op), "`"}, term.pos);
   
-  term.value.num *= una.op.kind == NodeKind::Minus ? -1 : +1;
+  term.value.num *= una.op == NodeKind::Minus ? -1 : +1;
   return term;
 }
 
-cstring_t NScript::Evaluator::evaluateOperationStr(Node op, cstring_t l, cstring_t r)
+NScript::Node NScript::Evaluator::evaluateOperationStr(NodeKind op, const Node& l, const Node& r, Position opPos)
 {
+  auto pos = Position(l.pos.startPos, r.pos.endPos);
+
   // string only supports `+` op
-  if (op.kind != NodeKind::Plus)
-    throw Error({"string does not support bin `", Node::kindToString(op.kind), "`"}, op.pos);
+  if (op != NodeKind::Plus)
+    return raise({"string does not support bin `", Node::kindToString(op), "`"}, opPos);
+
+  auto isBytes = isBinary(l) || isBinary(r);
+  auto lSlice  = expectStringSlice(l);
+  auto rSlice  = expectStringSlice(r);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto result = allocateString(lSlice.length + rSlice.length, opPos);
+
+  if (!result)
+    return Node::none(pos);
 
-  return cstringRealloc((std::string(l) + r).c_str());
+  // copying both strings straight into the result, the null terminator is already there
+  memcpy(result, lSlice.data, lSlice.length);
+  memcpy(result + lSlice.length, rSlice.data, rSlice.length);
+
+  if (isBytes)
+    return makeBytes(result, lSlice.length + rSlice.length, pos);
+
+  return Node(NodeKind::String, (NodeValue) { .str = result }, pos);
 }
 
 float64 NScript::Evaluator::evaluateOperationNum(NodeKind op, float64 l, float64 r, Position rPos)
@@ -412,7 +1119,10 @@ float64 NScript::Evaluator::evaluateOperationNum(NodeKind op, float64 l, float64
     case NodeKind::Star:  return l * r;
     case NodeKind::Slash:
       if (r == 0)
-        throw Error({"dividing by 0"}, rPos);
+      {
+        raise({"dividing by 0"}, rPos);
+        return 0;
+      }
 
       return l / r;
     
@@ -420,33 +1130,201 @@ float64 NScript::Evaluator::evaluateOperationNum(NodeKind op, float64 l, float64
   }
 }
 
-NScript::Node NScript::Evaluator::evaluateBin(BinNode bin)
+NScript::Node NScript::Evaluator::evaluatePipeline(const BinNode& pipe, Position pos)
 {
-  auto left  = evaluateNode(bin.left);
-  auto right = evaluateNode(bin.right);
+  auto scope  = AllocationScope(AllocationCategory::Io);
+  auto stream = openStreamStage(pipe.right, openStream(pipe.left));
 
-  // every bin op can only be applied to values of same type
-  if (left.kind != right.kind)
-    throw Error(
-      {"unkwnon bin `", bin.op.toString(), "` between different types (`", Node::kindToString(left.kind), "` and `", Node::kindToString(right.kind), "`)"},
-      bin.op.pos
-    );
-  
-  // recognizing the values' types
+  if (failed())
+    return Node::none(pos);
+
+  char line[streamLineSize];
+
+  // only one line at a time is in memory, whatever the size of the input is
+  while (stream->nextLine(line))
+    fiprintf(output, "%s\n", line);
+
+  // deleting the last stage deletes the whole pipeline
+  delete stream;
+  return Node::none(pos);
+}
+
+NScript::Stream* NScript::Evaluator::openStream(const Node& node)
+{
+  // `a | b | c` is parsed as `(a | b) | c`
+  if (node.kind == NodeKind::Bin && node.value.bin->op == NodeKind::Pipe)
+    return openStreamStage(node.value.bin->right, openStream(node.value.bin->left));
+
+  // builtins which can produce their output lazily
+  if (node.kind == NodeKind::Call && node.value.call->name.kind == NodeKind::Identifier)
+  {
+    const auto& call = *node.value.call;
+    auto        name = call.name.value.str;
+
+    if (isFilesystemCall(call) && !expectFilesystem(call.name.pos))
+      return nullptr;
+
+    // the entries of a folder given by a plain path are piped as well
+    if (!strcmp(name, "ls"))
+    {
+      if (call.args.size() != 1)
+        expectArgsCount(call, 0);
+
+      auto path = call.args.size() == 1 ? expectPath(call.args[0], false) : cwd;
+
+      if (!failed() && call.args.size() == 1 && Glob::hasWildcards(path))
+        raise({"only the entries of a folder can be piped"}, call.args[0].pos);
+
+      return failed() ? nullptr : new DirEntriesStream(opendir(path.c_str()));
+    }
+
+    // the fields are pulled one by one
+    if (!strcmp(name, "split") && call.args.size() == 2)
+    {
+      auto s         = expectStringSlice(evaluateNode(call.args[0]));
+      auto separator = expectStringSlice(evaluateNode(call.args[1]));
+
+      if (!failed() && separator.length == 0)
+        raise({"expected a non empty separator"}, call.args[1].pos);
+
+      return failed() ? nullptr : new SplitStream(s, separator);
+    }
+
+    // files read in binary mode are not split in lines
+    if (!strcmp(name, "read") && call.args.size() == 1)
+    {
+      auto path = expectPath(call.args[0], true);
+
+      if (failed())
+        return nullptr;
+
+      auto file = fopen(path.c_str(), "rb");
+
+      if (!file)
+      {
+        raise({"unable to open file `", path, "`"}, call.args[0].pos);
+        return nullptr;
+      }
+
+      return new FileLinesStream(file);
+    }
+  }
+
+  // any other string value is split in lines
+  auto value = evaluateNode(node);
+
+  if (failed())
+    return nullptr;
+
+  if (value.kind == NodeKind::LazyString)
+    return new LazyLinesStream(pageCache, *value.value.lazy);
+
+  value = materialize(value);
+
+  if (failed())
+    return nullptr;
+
+  if (value.kind != NodeKind::String)
+  {
+    raise({"type `", Node::kindToString(value.kind), "` cannot be piped"}, value.pos);
+    return nullptr;
+  }
+
+  return new StringLinesStream(value.value.str);
+}
+
+NScript::Stream* NScript::Evaluator::openStreamStage(const Node& node, Stream* upstream)
+{
+  if (failed())
+    return upstream;
+
+  if (node.kind != NodeKind::Call || node.value.call->name.kind != NodeKind::Identifier)
+  {
+    raise({"expected a pipeline stage call (found `", node.toString(), "`)"}, node.pos);
+    delete upstream;
+    return nullptr;
+  }
+
+  const auto& call  = *node.value.call;
+  auto        name  = call.name.value.str;
+  auto        stage = (Stream*)nullptr;
+
+  if (!strcmp(name, "filter"))
+  {
+    expectArgsCount(call, 1);
+
+    // the arg is not there when the count is wrong
+    auto pattern = failed() ? "" : expectStringLengthAndGetString(evaluateNode(call.args[0]), [] (uint64_t l) { return true; });
+
+    if (!failed())
+      stage = new FilterStream(upstream, pattern);
+  }
+  else if (!strcmp(name, "grep"))
+  {
+    expectArgsCount(call, 1);
+
+    auto grep = failed() ? Grep("") : expectGrepPattern(call.args[0]);
+
+    if (!failed())
+      stage = new GrepStream(upstream, grep);
+  }
+  else if (!strcmp(name, "head"))
+  {
+    expectArgsCount(call, 1);
+
+    auto count = failed() ? Node() : expectCount(evaluateNode(call.args[0]));
+
+    if (!failed())
+      stage = new HeadStream(upstream, uint64_t(count.value.num));
+  }
+  else
+    raise({"unknown pipeline stage"}, call.name.pos);
+
+  // the stage owns the upstream only once it's built
+  if (failed())
+    delete upstream;
+
+  return stage;
+}
+
+NScript::Node NScript::Evaluator::evaluateBin(const BinNode& bin)
+{
+  // pipelines are evaluated lazily, stage by stage
+  if (bin.op == NodeKind::Pipe)
+    return evaluatePipeline(bin, Position(bin.left.pos.startPos, bin.right.pos.endPos));
+
+  auto left = evaluateNode(bin.left);
+
+  if (failed())
+    return left;
+
+  auto right = evaluateNode(bin.right);
+
+  if (failed())
+    return right;
+
+  // strings of any kind are joined through their slices, their lengths are never scanned again
+  if (isStringKind(left.kind) && isStringKind(right.kind))
+    return evaluateOperationStr(bin.op, left, right, bin.opPos);
+
+  // every bin op can only be applied to values of same type
+  if (left.kind != right.kind)
+    return raise(
+      {"unkwnon bin `", Node::kindToString(bin.op), "` between different types (`", Node::kindToString(left.kind), "` and `", Node::kindToString(right.kind), "`)"},
+      bin.opPos
+    );
+  
+  // recognizing the values' types
   switch (left.kind)
   {
     case NodeKind::Num:
-      left.value.num = evaluateOperationNum(bin.op.kind, left.value.num, right.value.num, right.pos);
-      break;
-    
-    case NodeKind::String:
-      left.value.str = evaluateOperationStr(bin.op, left.value.str, right.value.str);
+      left.value.num = evaluateOperationNum(bin.op, left.value.num, right.value.num, right.pos);
       break;
 
     default:
-      throw Error(
+      return raise(
         {"type `", Node::kindToString(left.kind), "` does not support bin"},
-        bin.op.pos
+        bin.opPos
       );
   }
 
@@ -455,50 +1333,89 @@ NScript::Node NScript::Evaluator::evaluateBin(BinNode bin)
   return left;
 }
 
-NScript::Node NScript::Evaluator::evaluateIdentifier(Node identifier)
+NScript::Node NScript::Evaluator::evaluateIdentifier(const Node& identifier)
 {
+  // inside a function the params shadow the variables
+  if (currentFunction)
+    for (uint64_t i = 0; i < currentFunction->params.size(); i++)
+      if (!strcmp(currentFunction->params[i].value.str, identifier.value.str))
+        return expectUnchangedFile(frames[frameBase + i], identifier.pos);
+
   for (const auto& kv : map)
-    if (kv.key == std::string(identifier.value.str))
-      return kv.val;
+    if (kv.key == identifier.value.str)
+      return expectUnchangedFile(kv.val, identifier.pos);
   
-  throw Error({"unknown variable"}, identifier.pos);
+  return raise({"unknown variable"}, identifier.pos);
 }
 
-NScript::Node NScript::Evaluator::evaluateNode(Node node)
+NScript::Node NScript::Evaluator::expectUnchangedFile(const Node& value, Position pos)
 {
+  if (value.kind == NodeKind::LazyString && pageCache.isChanged(*value.value.lazy))
+    return raise({"file `", value.value.lazy->path, "` changed since read"}, pos);
+
+  return value;
+}
+
+NScript::Node NScript::Evaluator::evaluateNode(const Node& node)
+{
+  auto result = Node();
+
   switch (node.kind)
   {
     case NodeKind::Num:
     case NodeKind::String:
+    case NodeKind::LazyString:
+    case NodeKind::StringSlice:
+    case NodeKind::Bytes:
     case NodeKind::None:       return node;
-    case NodeKind::Bin:        return evaluateBin(*node.value.bin);
-    case NodeKind::Una:        return evaluateUna(*node.value.una);
-    case NodeKind::Identifier: return evaluateIdentifier(node);
-    case NodeKind::Assign:     return evaluateAssign(*node.value.assign, node.pos);
-    case NodeKind::Call:       return evaluateCall(*node.value.call, node.pos);
+    case NodeKind::Bin:        result = evaluateBin(*node.value.bin); break;
+    case NodeKind::Una:        result = evaluateUna(*node.value.una); break;
+    case NodeKind::Identifier: result = evaluateIdentifier(node); break;
+    case NodeKind::Assign:     result = evaluateAssign(*node.value.assign, node.pos); break;
+    case NodeKind::Def:        result = evaluateDef(*node.value.def, node.pos); break;
+    case NodeKind::Call:       result = evaluateCall(*node.value.call, node.pos); break;
     default:                   panic("unimplemented evaluateNode for some NodeKind"); return Node::none(node.pos);
   }
+
+  // the innermost node which allocated through the emergency reserve reports it
+  if (allocationCounter.isOutOfMemory)
+    return raiseOutOfMemory(node.pos);
+
+  return result;
 }
 
-std::string NScript::Evaluator::expectStringLengthAndGetString(Node node, std::function<bool(uint64_t)> f)
+cstring_t NScript::Evaluator::expectStringLengthAndGetString(const Node& node, bool (*isLengthAllowed)(uint64_t))
 {
-  auto s = std::string(node.value.str);
+  if (failed())
+    return "";
+
+  auto s = expectType(node, NodeKind::String).value.str;
 
-  if (!f(s.length()))
-    throw Error({"expected a string with a different length"}, node.pos);
+  if (failed())
+    return "";
+
+  if (!isLengthAllowed(strlen(s)))
+  {
+    raise({"expected a string with a different length"}, node.pos);
+    return "";
+  }
   
   return s;
 }
 
-void NScript::Evaluator::builtinCd(CallNode call)
+void NScript::Evaluator::builtinCd(const CallNode& call)
 {
   expectArgsCount(call, 1);
 
+  if (failed())
+    return;
+
   // expecting the only 1 arg is a string and expecting it to be a non-empty one
-  auto arg            = call.args[0];
-  auto dir            = expectNonEmptyStringAndGetString(expectType(evaluateNode(arg), NodeKind::String));
-  
-  dir = getFullPath(dir, false);
+  const auto& arg = call.args[0];
+  auto dir        = expectPath(arg, false);
+
+  if (failed())
+    return;
 
   // opening dir
   auto openedDir = opendir(dir.c_str());
@@ -508,7 +1425,10 @@ void NScript::Evaluator::builtinCd(CallNode call)
 
   // checking for dir correctly opened
   if (!openedDir)
-    throw Error({"unknown dir `", dir, "`"}, arg.pos);
+  {
+    raise({"unknown dir `", dir, "`"}, arg.pos);
+    return;
+  }
   
   // closing dir, because we will no longer need it (opened just to check that it existed)
   closedir(openedDir);
@@ -517,116 +1437,1773 @@ void NScript::Evaluator::builtinCd(CallNode call)
   cwd = dir;
 }
 
-void NScript::Evaluator::builtinClear(CallNode call)
+void NScript::Evaluator::builtinClear(const CallNode& call)
 {
   expectArgsCount(call, 0);
-  consoleClear();
+
+  if (!failed())
+    consoleClear();
 }
 
-void NScript::Evaluator::builtinShutdown(CallNode call)
+void NScript::Evaluator::builtinShutdown(const CallNode& call)
 {
   expectArgsCount(call, 0);
+
+  if (failed())
+    return;
+
+#ifdef ARM9
+  // the session is saved first, so that it can be loaded after the next boot, but a missing card can't keep the ds on
+  if (!mountFilesystem() || !saveSession(defaultSnapshotPath))
+  {
+    fiprintf(output, "unable to save the session to `%s`, shutting down anyway\n", defaultSnapshotPath);
+
+    // leaving the warning on screen for a while
+    for (uint64_t i = 0; i < shutdownWarningFrames; i++)
+      swiWaitForVBlank();
+  }
+
   systemShutDown();
+#else
+  // the host runner would be shut down with all its scripts
+  raise({"shutdown is only available on the ds"}, call.name.pos);
+#endif
+}
+
+void NScript::Evaluator::builtinLs(const CallNode& call)
+{
+  // `ls(pattern)` lists the matching entries below the cwd
+  if (call.args.size() == 1)
+  {
+    auto pattern = expectPath(call.args[0], true);
+
+    if (failed())
+      return;
+
+    if (Glob::hasWildcards(pattern))
+    {
+      forEachGlobMatch(pattern, call.args[0].pos, true, true, [this] (cstring_t matchedPath) {
+        fiprintf(output, "%s\n", getDisplayedPath(matchedPath));
+        return false;
+      });
+
+      return;
+    }
+
+    // a plain path lists the entries of the folder, or shows the file
+    struct stat info;
+
+    if (stat(pattern.c_str(), &info))
+      raise({"unable to find `", pattern, "`"}, call.args[0].pos);
+    else if (!S_ISDIR(info.st_mode))
+      fiprintf(output, "%s\n", getDisplayedPath(pattern.c_str()));
+    else
+      printDirEntries(pattern);
+
+    return;
+  }
+
+  expectArgsCount(call, 0);
+
+  if (!failed())
+    printDirEntries(cwd);
 }
 
-void NScript::Evaluator::builtinLs(CallNode call)
+void NScript::Evaluator::printDirEntries(const std::string& path)
 {
-  auto dir = opendir(cwd.c_str());
+  auto entries = DirEntriesStream(opendir(path.c_str()));
+  char line[streamLineSize];
 
   // iterating the directory
-  while (auto entry = readdir(dir))
-    iprintf(
-      "%s (%s)\n", entry->d_name,
-      // not all file systems support dirent.d_type, when possible prints:
-      //  `file`   -> for regular files
-      //  `folder` -> for directories
-      //  `other`  -> for other elment's types (see https://ftp.gnu.org/old-gnu/Manuals/glibc-2.2.5/html_node/Directory-Entries.html)
-      //  `?`      -> for unknown elements (they could be files, folders or other)
-      entry->d_type == DT_REG ? "file" : entry->d_type == DT_DIR ? "folder" : entry->d_type == DT_UNKNOWN ? "?" : "other");
-  
-  closedir(dir);
+  while (entries.nextLine(line))
+    fiprintf(output, "%s\n", line);
 }
 
-void NScript::Evaluator::builtinRmDir(CallNode call)
+void NScript::Evaluator::builtinRmDir(const CallNode& call)
 {
   expectArgsCount(call, 1);
 
-  auto arg  = call.args[0];
-  auto path = getFullPath(expectNonEmptyStringAndGetString(evaluateNode(arg)), false);
+  if (failed())
+    return;
+
+  const auto& arg = call.args[0];
+  auto pattern    = expectPath(arg, true);
+
+  if (failed())
+    return;
+
+  // `rmdir('backups/*')` removes all the matching folders
+  if (Glob::hasWildcards(pattern))
+  {
+    uint64_t failures = 0;
+
+    forEachGlobMatch(pattern, arg.pos, false, true, [this, &failures] (cstring_t matchedPath) {
+      auto isRemoved = removeAllInsideDir(matchedPath) == 0 && !rmdir(matchedPath);
+
+      if (!isRemoved)
+      {
+        fiprintf(output, "unable to delete `%s`\n", matchedPath);
+        failures++;
+      }
+
+      return isRemoved;
+    });
+
+    if (!failed() && failures > 0)
+      raise({"unable to delete `", std::to_string(failures), "` of the matching folders"}, arg.pos);
+
+    return;
+  }
+
+  auto path = addTrailingSlashToPath(pattern);
+
+  struct stat info;
+
+  if (stat(path.c_str(), &info) || !S_ISDIR(info.st_mode))
+  {
+    raise({"unable to find folder `", path, "`"}, arg.pos);
+    return;
+  }
 
   // removing all files and sub folders into directory (rmdir can only remove empty folders)
-  removeAllInsideDir(path);
+  auto failures = removeAllInsideDir(path);
+
+  if (failures > 0)
+  {
+    raise({"unable to delete `", std::to_string(failures), "` entries inside folder `", path, "`"}, arg.pos);
+    return;
+  }
 
   // removing the empty folder
   if (rmdir(path.c_str()))
-    throw Error({"unable to delete folder `", path, "`"}, arg.pos);
+    raise({"unable to delete folder `", path, "`"}, arg.pos);
 }
 
-void NScript::Evaluator::builtinMkDir(CallNode call)
+uint64_t NScript::Evaluator::removeAllInsideDir(const std::string& path)
 {
-  expectArgsCount(call, 1);
+  // a folder is removed once all its entries are
+  auto     walker   = DirWalker(path.c_str());
+  uint64_t removed  = 0;
+  uint64_t failures = 0;
 
-  auto arg  = call.args[0];
-  auto path = getFullPath(expectNonEmptyStringAndGetString(evaluateNode(arg)), false);
+  while (walker.next())
+  {
+    auto isRemoved = false;
 
-  if (mkdir(path.c_str(), S_IRUSR))
-    throw Error({"unable to make folder `", path, "`"}, arg.pos);
+    switch (walker.event)
+    {
+      case WalkEvent::File:     isRemoved = !remove(walker.getPath()); break;
+      case WalkEvent::LeaveDir: isRemoved = !rmdir(walker.getPath()); break;
+      case WalkEvent::EnterDir: continue;
+      case WalkEvent::Error:    break;
+    }
+
+    if (!isRemoved)
+    {
+      fiprintf(output, "unable to delete `%s`\n", walker.getPath());
+      failures++;
+      continue;
+    }
+
+    walker.entryRemoved();
+
+    if (++removed % rmdirProgressInterval == 0)
+      fiprintf(output, "removed %lu entries...\n", (unsigned long)removed);
+  }
+
+  return failures;
+}
+
+NScript::StringSlice NScript::Evaluator::expectStringSlice(const Node& value)
+{
+  if (failed())
+    return StringSlice("", 0);
+
+  // lazy strings are loaded
+  auto s = value.kind == NodeKind::LazyString ? materialize(value) : value;
+
+  if (failed())
+    return StringSlice("", 0);
+
+  if (s.kind == NodeKind::StringSlice || s.kind == NodeKind::Bytes)
+    return *s.value.slice;
+
+  s = expectType(s, NodeKind::String);
+
+  return failed() ? StringSlice("", 0) : StringSlice(s.value.str, strlen(s.value.str));
+}
+
+NScript::Node NScript::Evaluator::makeStringSlice(const char* data, uint64_t length, Position pos)
+{
+  auto scope = AllocationScope(AllocationCategory::Strings);
+
+  return Node(NodeKind::StringSlice, (NodeValue) { .slice = new StringSlice(data, length) }, pos);
+}
+
+NScript::Node NScript::Evaluator::makeBytes(const char* data, uint64_t length, Position pos)
+{
+  auto scope = AllocationScope(AllocationCategory::Strings);
+
+  return Node(NodeKind::Bytes, (NodeValue) { .slice = new StringSlice(data, length) }, pos);
+}
+
+NScript::Node NScript::Evaluator::makeString(char* content, uint64_t length, bool isBinary, Position pos)
+{
+  // a plain string would be cut at its first null char
+  if (isBinary || memchr(content, '\0', length))
+    return makeBytes(content, length, pos);
+
+  return Node(NodeKind::String, (NodeValue) { .str = content }, pos);
 }
 
-void NScript::Evaluator::builtinRmFile(CallNode call)
+NScript::Node NScript::Evaluator::builtinLen(const CallNode& call, Position pos)
 {
   expectArgsCount(call, 1);
 
-  auto arg  = call.args[0];
-  auto path = getFullPath(expectNonEmptyStringAndGetString(evaluateNode(arg)), true);
+  if (failed())
+    return Node::none(pos);
 
-  if (remove(path.c_str()))
-    throw Error({"unable to delete file `", path, "`"}, arg.pos);
+  auto value = evaluateNode(call.args[0]);
+
+  if (failed())
+    return value;
+
+  // the size of a lazy string is known without loading it
+  auto length = value.kind == NodeKind::LazyString ? value.value.lazy->size : expectStringSlice(value).length;
+
+  if (failed())
+    return Node::none(pos);
+
+  return Node(NodeKind::Num, (NodeValue) { .num = float64(length) }, pos);
 }
 
-void NScript::Evaluator::builtinWrite(CallNode call)
+NScript::Node NScript::Evaluator::builtinSlice(const CallNode& call, Position pos)
 {
-  expectArgsCount(call, 2);
+  expectArgsCount(call, 3);
 
-  auto arg     = call.args[0];
-  auto arg2    = call.args[1];
-  auto path    = getFullPath(expectNonEmptyStringAndGetString(evaluateNode(arg)), true);
-  auto content = expectStringLengthAndGetString(evaluateNode(arg2), [] (uint64_t l) { return true; });
-  auto file    = fopen(path.c_str(), "wb");
+  if (failed())
+    return Node::none(pos);
 
-  if (!file)
-    throw Error({"unable to make file `", path, "`"}, arg.pos);
-  
-  fiprintf(file, content.c_str());
-  fclose(file);
+  auto value = evaluateNode(call.args[0]);
+  auto start = expectType(evaluateNode(call.args[1]), NodeKind::Num).value.num;
+  auto end   = expectType(evaluateNode(call.args[2]), NodeKind::Num).value.num;
+
+  if (failed())
+    return Node::none(pos);
+
+  auto isLazy = value.kind == NodeKind::LazyString;
+  auto s      = isLazy ? StringSlice(nullptr, value.value.lazy->size) : expectStringSlice(value);
+
+  if (failed())
+    return Node::none(pos);
+
+  // negative indices count from the end, then both are clamped inside the string
+  auto length     = float64(s.length);
+  auto firstIndex = uint64_t(std::clamp(start < 0 ? start + length : start, 0.0, length));
+  auto lastIndex  = uint64_t(std::clamp(end < 0 ? end + length : end, 0.0, length));
+
+  if (lastIndex < firstIndex)
+    lastIndex = firstIndex;
+
+  if (!isLazy)
+    return value.kind == NodeKind::Bytes ? makeBytes(s.data + firstIndex, lastIndex - firstIndex, pos) : makeStringSlice(s.data + firstIndex, lastIndex - firstIndex, pos);
+
+  // only the pages of the slice are loaded
+  auto content = allocateString(lastIndex - firstIndex, pos);
+
+  if (!content)
+    return Node::none(pos);
+
+  auto readLength = pageCache.read(*value.value.lazy, firstIndex, lastIndex - firstIndex, content);
+
+  content[readLength] = '\0';
+  return makeString(content, readLength, value.value.lazy->isBinary, pos);
+}
+
+NScript::Node NScript::Evaluator::builtinStringFind(const CallNode& call, Position pos)
+{
+  auto s      = expectStringSlice(evaluateNode(call.args[0]));
+  auto needle = expectStringSlice(evaluateNode(call.args[1]));
+
+  if (failed())
+    return Node::none(pos);
+
+  // single char needles are searched with memchr
+  auto occurrence = LiteralMatcher(std::string(needle.data, needle.length)).find(s.data, s.length);
+
+  return Node(NodeKind::Num, (NodeValue) { .num = occurrence ? float64(occurrence - s.data) : -1 }, pos);
+}
+
+NScript::Node NScript::Evaluator::builtinSplit(const CallNode& call, Position pos)
+{
+  if (call.args.size() != 3)
+    expectArgsCount(call, 2);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto s         = expectStringSlice(evaluateNode(call.args[0]));
+  auto separator = expectStringSlice(evaluateNode(call.args[1]));
+
+  if (!failed() && separator.length == 0)
+    raise({"expected a non empty separator"}, call.args[1].pos);
+
+  if (failed())
+    return Node::none(pos);
+
+  // printing all the fields
+  if (call.args.size() == 2)
+  {
+    auto fields = SplitStream(s, separator);
+    char line[streamLineSize];
+
+    while (fields.nextLine(line))
+      fiprintf(output, "%s\n", line);
+
+    return Node::none(pos);
+  }
+
+  auto index = expectType(evaluateNode(call.args[2]), NodeKind::Num);
+
+  if (failed())
+    return Node::none(pos);
+
+  if (index.value.num < 0)
+    return raise({"the string has no field `", index.toString(), "`"}, index.pos);
+
+  auto matcher = LiteralMatcher(std::string(separator.data, separator.length));
+  auto field   = s.data;
+  auto end     = s.data + s.length;
+
+  // skipping the fields before the wanted one
+  for (uint64_t i = 0; i < uint64_t(index.value.num); i++)
+  {
+    auto occurrence = matcher.find(field, end - field);
+
+    if (!occurrence)
+      return raise({"the string has no field `", index.toString(), "`"}, index.pos);
+
+    field = occurrence + separator.length;
+  }
+
+  auto fieldEnd = matcher.find(field, end - field);
+
+  return makeStringSlice(field, (fieldEnd ? fieldEnd : end) - field, pos);
+}
+
+NScript::Node NScript::Evaluator::builtinReplace(const CallNode& call, Position pos)
+{
+  expectArgsCount(call, 3);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto value = evaluateNode(call.args[0]);
+  auto s     = expectStringSlice(value);
+  auto from  = expectStringSlice(evaluateNode(call.args[1]));
+  auto to    = expectStringSlice(evaluateNode(call.args[2]));
+
+  if (!failed() && from.length == 0)
+    raise({"expected a non empty string to replace"}, call.args[1].pos);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto     matcher     = LiteralMatcher(std::string(from.data, from.length));
+  auto     end         = s.data + s.length;
+  uint64_t occurrences = 0;
+
+  // counting the occurrences first, so that the result is allocated once
+  for (auto o = matcher.find(s.data, s.length); o; o = matcher.find(o + from.length, end - o - from.length))
+    occurrences++;
+
+  auto length = s.length - occurrences * from.length + occurrences * to.length;
+  auto result = allocateString(length, pos);
+
+  if (!result)
+    return Node::none(pos);
+
+  auto written = result;
+  auto copied  = s.data;
+
+  for (auto o = matcher.find(s.data, s.length); o; o = matcher.find(o + from.length, end - o - from.length))
+  {
+    memcpy(written, copied, o - copied);
+    written += o - copied;
+
+    memcpy(written, to.data, to.length);
+    written += to.length;
+    copied   = o + from.length;
+  }
+
+  memcpy(written, copied, end - copied);
+  return makeString(result, length, isBinary(value), pos);
 }
 
-NScript::Node NScript::Evaluator::builtinRead(CallNode call, Position pos)
+NScript::Node NScript::Evaluator::builtinChangeCase(const CallNode& call, Position pos, bool isUpper)
 {
   expectArgsCount(call, 1);
 
-  auto arg     = call.args[0];
-  auto path    = getFullPath(expectNonEmptyStringAndGetString(evaluateNode(arg)), true);
-  auto content = std::string();
-  auto file    = fopen(path.c_str(), "rb");
+  if (failed())
+    return Node::none(pos);
 
-  if (!file)
-    throw Error({"unable to open file `", path, "`"}, arg.pos);
+  auto value = evaluateNode(call.args[0]);
+  auto s     = expectStringSlice(value);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto result = allocateString(s.length, pos);
+
+  if (!result)
+    return Node::none(pos);
 
-  auto c = getc(file);
+  for (uint64_t i = 0; i < s.length; i++)
+    result[i] = isUpper ? toupper(uint8_t(s.data[i])) : tolower(uint8_t(s.data[i]));
 
-  while (c != EOF) {
-    content.push_back(c);
-    c = getc(file);
+  return makeString(result, s.length, isBinary(value), pos);
+}
+
+NScript::Node NScript::Evaluator::builtinTrim(const CallNode& call, Position pos)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto value = evaluateNode(call.args[0]);
+  auto s     = expectStringSlice(value);
+
+  if (failed())
+    return Node::none(pos);
+
+  while (s.length > 0 && isspace(uint8_t(s.data[0])))
+  {
+    s.data++;
+    s.length--;
   }
 
-  fclose(file);
-  return Node(NodeKind::String, (NodeValue) { .str = cstringRealloc(content.c_str()) }, pos);
+  while (s.length > 0 && isspace(uint8_t(s.data[s.length - 1])))
+    s.length--;
+
+  return isBinary(value) ? makeBytes(s.data, s.length, pos) : makeStringSlice(s.data, s.length, pos);
 }
 
-std::string NScript::Evaluator::expectNonEmptyStringAndGetString(Node node)
+void NScript::Evaluator::builtinCompress(const CallNode& call)
 {
-  return expectStringLengthAndGetString(node, [] (uint64_t l) { return l > 0; });
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  auto sourcePath      = expectPath(call.args[0], true);
+  auto destinationPath = expectPath(call.args[1], true);
+
+  if (failed())
+    return;
+
+  auto source = fopen(sourcePath.c_str(), "rb");
+
+  if (!source)
+  {
+    raise({"unable to open file `", sourcePath, "`"}, call.args[0].pos);
+    return;
+  }
+
+  fseek(source, 0, SEEK_END);
+
+  uint64_t size = ftell(source);
+
+  fseek(source, 0, SEEK_SET);
+
+  // the header has only 24 bits for the size
+  if (size > lz77MaxSize)
+  {
+    fclose(source);
+    raise({"unable to compress files bigger than `", std::to_string(lz77MaxSize), "` bytes"}, call.args[0].pos);
+    return;
+  }
+
+  if (!expectBudget(sizeof(Lz77Compressor), call.name.pos))
+  {
+    fclose(source);
+    return;
+  }
+
+  auto destination = fopen(destinationPath.c_str(), "wb");
+
+  if (!destination)
+  {
+    fclose(source);
+    raise({"unable to make file `", destinationPath, "`"}, call.args[1].pos);
+    return;
+  }
+
+  auto scope        = AllocationScope(AllocationCategory::Io);
+  auto compressor   = new Lz77Compressor();
+  auto isCompressed = compressor->compress(source, size, destination);
+  auto written      = compressor->getWrittenBytes();
+
+  delete compressor;
+  fclose(source);
+
+  if (fclose(destination) || !isCompressed)
+  {
+    raise({"unable to compress `", sourcePath, "` to `", destinationPath, "`"}, call.args[1].pos);
+    return;
+  }
+
+  fiprintf(output, "%lu B -> %lu B (%lu%%)\n", (unsigned long)size, (unsigned long)written, (unsigned long)(size > 0 ? written * 100 / size : 100));
+}
+
+NScript::Node NScript::Evaluator::builtinDecompress(const CallNode& call, Position pos)
+{
+  if (call.args.size() != 1)
+    expectArgsCount(call, 2);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto sourcePath      = expectPath(call.args[0], true);
+  auto destinationPath = call.args.size() == 2 ? expectPath(call.args[1], true) : std::string();
+
+  if (failed())
+    return Node::none(pos);
+
+  auto source = fopen(sourcePath.c_str(), "rb");
+
+  if (!source)
+    return raise({"unable to open file `", sourcePath, "`"}, call.args[0].pos);
+
+  fseek(source, 0, SEEK_END);
+
+  uint64_t length = ftell(source);
+
+  fseek(source, 0, SEEK_SET);
+
+  if (!expectBudget(length, call.name.pos))
+  {
+    fclose(source);
+    return Node::none(pos);
+  }
+
+  // the compressed data is loaded with a single read, then decompressed all at once (by the bios on the ds)
+  auto scope      = AllocationScope(AllocationCategory::Io);
+  auto compressed = new uint8_t[length];
+  auto isRead     = fread(compressed, 1, length, source) == length;
+  uint64_t size   = 0;
+
+  fclose(source);
+
+  if (!isRead || !readLz77Header(compressed, length, size))
+  {
+    delete [] compressed;
+    return raise({"`", sourcePath, "` is not compressed in the lz77 format"}, call.args[0].pos);
+  }
+
+  // the decompressed content is the string itself when there's no destination
+  auto content = allocateString(size, call.name.pos);
+
+  if (failed() || !decompressLz77(compressed, length, (uint8_t*)content))
+  {
+    delete [] compressed;
+    delete [] content;
+    return failed() ? Node::none(pos) : raise({"the compressed data of `", sourcePath, "` is corrupted"}, call.args[0].pos);
+  }
+
+  delete [] compressed;
+
+  // binary content is returned as bytes
+  if (call.args.size() == 1)
+    return makeString(content, size, false, pos);
+
+  auto destination = fopen(destinationPath.c_str(), "wb");
+  auto isWritten   = destination && fwrite(content, 1, size, destination) == size;
+
+  delete [] content;
+
+  if (!destination || fclose(destination) || !isWritten)
+    return raise({"unable to write file `", destinationPath, "`"}, call.args[1].pos);
+
+  return Node::none(pos);
+}
+
+NScript::Node NScript::Evaluator::builtinChecksum(const CallNode& call, Position pos, ChecksumKind kind, bool isString)
+{
+  if (call.args.size() != 2)
+    expectArgsCount(call, 1);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto value = evaluateNode(call.args[0]);
+  auto seed  = call.args.size() == 2 ? expectCount(evaluateNode(call.args[1])).value.num : kind == ChecksumKind::Crc16 ? defaultCrc16Seed : 0;
+
+  if (failed())
+    return Node::none(pos);
+
+  auto checksum = Checksum(kind, uint32_t(seed));
+
+  if (!isString)
+  {
+    auto path = expectNonEmptyStringAndGetString(value);
+
+    if (failed() || !checksumFile(getFullPath(path, true), checksum, call.args[0].pos))
+      return Node::none(pos);
+  }
+  // lazy strings are read from their file in big blocks, without going through the pages cache
+  else if (value.kind == NodeKind::LazyString)
+  {
+    expectUnchangedFile(value, call.args[0].pos);
+
+    if (failed() || !checksumFile(value.value.lazy->path, checksum, call.args[0].pos))
+      return Node::none(pos);
+  }
+  else
+  {
+    auto s = expectStringSlice(value);
+
+    if (failed())
+      return Node::none(pos);
+
+    checksum.update((const uint8_t*)s.data, s.length);
+  }
+
+  return Node(NodeKind::Num, (NodeValue) { .num = float64(checksum.finish()) }, pos);
+}
+
+bool NScript::Evaluator::checksumFile(const std::string& path, Checksum& checksum, Position pos)
+{
+  if (!expectFilesystem(pos))
+    return false;
+
+  auto file = fopen(path.c_str(), "rb");
+
+  if (!file)
+  {
+    raise({"unable to open file `", path, "`"}, pos);
+    return false;
+  }
+
+  if (!expectBudget(checksumBlockSize, pos))
+  {
+    fclose(file);
+    return false;
+  }
+
+  auto     scope = AllocationScope(AllocationCategory::Io);
+  auto     block = new uint8_t[checksumBlockSize];
+  uint64_t length;
+
+  while ((length = fread(block, 1, checksumBlockSize, file)) > 0)
+    checksum.update(block, length);
+
+  auto isRead = !ferror(file);
+
+  delete [] block;
+  fclose(file);
+
+  if (!isRead)
+    raise({"unable to read file `", path, "`"}, pos);
+
+  return isRead;
+}
+
+void NScript::Evaluator::builtinMem(const CallNode& call)
+{
+  expectArgsCount(call, 0);
+
+  if (failed())
+    return;
+
+  printAllocationReport(output, allocationCounter);
+  fiprintf(output, "budget %lu B\n", (unsigned long)memoryBudget);
+
+  if (astCache != nullptr)
+    fiprintf(output, 
+      "ast cache %lu B, %lu entries, %lu hits, %lu misses\n",
+      (unsigned long)astCache->getUsedBytes(), (unsigned long)astCache->getEntriesCount(),
+      (unsigned long)astCache->hits, (unsigned long)astCache->misses
+    );
+}
+
+void NScript::Evaluator::builtinBudget(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  auto bytes = expectCount(evaluateNode(call.args[0]));
+
+  if (!failed())
+    memoryBudget = uint64_t(bytes.value.num);
+}
+
+void NScript::Evaluator::builtinBoot(const CallNode& call)
+{
+  expectArgsCount(call, 0);
+
+  if (!failed())
+    printBootReport(output);
+}
+
+void NScript::Evaluator::builtinPageCache(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  auto count = expectCount(evaluateNode(call.args[0]));
+
+  // without pages every access of a lazy string would miss
+  if (!failed() && count.value.num < 1)
+    raise({"expected at least `1` page (found `", count.toString(), "`)"}, count.pos);
+
+  if (!failed())
+    pageCache.setMaxPages(uint64_t(count.value.num));
+}
+
+void NScript::Evaluator::builtinSave(const CallNode& call)
+{
+  auto path = expectSnapshotPath(call);
+
+  if (!failed() && !saveSession(path))
+    raise({"unable to write file `", path, "`"}, call.name.pos);
+}
+
+void NScript::Evaluator::builtinLoad(const CallNode& call)
+{
+  auto path = expectSnapshotPath(call);
+
+  if (failed())
+    return;
+
+  auto file = fopen(path.c_str(), "rb");
+
+  if (!file)
+  {
+    raise({"unable to open file `", path, "`"}, call.name.pos);
+    return;
+  }
+
+  fseek(file, 0, SEEK_END);
+
+  uint64_t size = ftell(file);
+
+  fseek(file, 0, SEEK_SET);
+
+  if (!expectBudget(size, call.name.pos))
+  {
+    fclose(file);
+    return;
+  }
+
+  auto scope = AllocationScope(AllocationCategory::Variables);
+
+  // the whole snapshot is loaded with a single read, the strings of the variables point inside it
+  auto buffer   = new char[size];
+  auto isRead   = fread(buffer, 1, size, file) == size;
+  auto snapshot = Snapshot();
+
+  fclose(file);
+
+  auto isLoaded = isRead && readSnapshot(buffer, size, snapshot);
+  auto defs     = std::vector<Node>();
+
+  // the functions are parsed again from the text of their defs
+  for (uint64_t i = 0; isLoaded && i < snapshot.functions.size(); i++)
+  {
+    auto parser = Parser(snapshot.functions[i]);
+    auto tree   = parser.parse();
+
+    isLoaded = !parser.failed() && tree.kind == NodeKind::Def;
+
+    if (!parser.failed())
+      defs.push_back(tree);
+  }
+
+  if (!isLoaded)
+  {
+    for (const auto& v : snapshot.variables)
+      if (v.val.kind == NodeKind::LazyString)
+        delete v.val.value.lazy;
+      else if (v.val.kind == NodeKind::StringSlice || v.val.kind == NodeKind::Bytes)
+        delete v.val.value.slice;
+
+    for (const auto& def : defs)
+      Parser::deleteTree(def);
+
+    delete [] buffer;
+    raise({"the snapshot `", path, "` is corrupted or was made by another version"}, call.name.pos);
+    return;
+  }
+
+  // the buffer is kept only when some string points inside it (the variables' strings are never freed)
+  if (std::none_of(snapshot.variables.begin(), snapshot.variables.end(), [] (const KeyPair<std::string, Node>& v) { return v.val.kind == NodeKind::String || v.val.kind == NodeKind::StringSlice || v.val.kind == NodeKind::Bytes; }))
+    delete [] buffer;
+
+  map = std::move(snapshot.variables);
+  cwd = snapshot.cwd;
+
+  // the functions of the session are replaced as well, the ones being evaluated are freed once their calls return
+  for (const auto& f : functions)
+    if (callDepth > 0)
+      retiredDefs.push_back(f.val);
+    else
+      Parser::deleteTree(f.val);
+
+  functions.clear();
+
+  for (const auto& def : defs)
+  {
+    evaluateDef(*def.value.def, def.pos);
+    Parser::deleteTree(def);
+  }
+
+  if (history != nullptr)
+  {
+    auto historyScope = AllocationScope(AllocationCategory::History);
+    auto prompts      = std::vector<std::string*>();
+
+    for (const auto& prompt : snapshot.history)
+      prompts.push_back(new std::string(prompt));
+
+    // the loaded prompts are older than the ones of this session
+    history->insert(history->begin(), prompts.begin(), prompts.end());
+  }
+
+  fiprintf(
+    output, "loaded %lu variables, %lu functions and %lu prompts\n",
+    (unsigned long)map.size(), (unsigned long)functions.size(), (unsigned long)snapshot.history.size()
+  );
+}
+
+void NScript::Evaluator::builtinRecord(const CallNode& call)
+{
+  if (!expectInputLog(call))
+    return;
+
+  // `record()` stops the recording and writes the frames left, it does nothing when replaying the end of a recording
+  if (call.args.empty())
+  {
+    if (inputLog->getMode() != InputLogMode::Recording)
+      return;
+
+    auto framesCount = inputLog->getFramesCount();
+    auto path        = inputLog->getPath();
+
+    if (!inputLog->stop())
+      raise({"unable to write file `", path, "`"}, call.name.pos);
+    else
+      fiprintf(output, "recorded %lu frames into `%s`\n", (unsigned long)framesCount, path.c_str());
+
+    return;
+  }
+
+  expectArgsCount(call, 1);
+
+  if (failed() || !expectNotReplaying(call))
+    return;
+
+  auto path = expectPath(call.args[0], true);
+
+  if (!failed() && !inputLog->startRecording(path))
+    raise({"unable to write file `", path, "`"}, call.name.pos);
+}
+
+void NScript::Evaluator::builtinReplay(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed() || !expectInputLog(call) || !expectNotReplaying(call))
+    return;
+
+  auto path = expectPath(call.args[0], true);
+
+  // the replay starts from the next frame, the one running this prompt is not part of it
+  if (!failed() && !inputLog->startReplay(path))
+    raise({"the recording `", path, "` could not be read or is corrupted"}, call.name.pos);
+}
+
+bool NScript::Evaluator::expectInputLog(const CallNode& call)
+{
+  if (inputLog == nullptr)
+    raise({"there's no input to record outside of the console"}, call.name.pos);
+
+  return !failed();
+}
+
+bool NScript::Evaluator::expectNotReplaying(const CallNode& call)
+{
+  if (inputLog->getMode() == InputLogMode::Replaying)
+    raise({"a recording is being replayed"}, call.name.pos);
+
+  return !failed();
+}
+
+std::string NScript::Evaluator::expectSnapshotPath(const CallNode& call)
+{
+  if (call.args.size() > 1)
+  {
+    raise({"expected `0` or `1` args (found `", std::to_string(call.args.size()), "`)"}, call.name.pos);
+    return std::string();
+  }
+
+  if (call.args.empty())
+    return defaultSnapshotPath;
+
+  return expectPath(call.args[0], true);
+}
+
+bool NScript::Evaluator::saveSession(const std::string& path)
+{
+  // the snapshot is written aside, so that a failed write leaves the previous one whole
+  auto temporaryPath = path + ".tmp";
+  auto file          = fopen(temporaryPath.c_str(), "wb");
+
+  if (!file)
+    return false;
+
+  auto isWritten = writeSnapshot(file, cwd, map, functions, history != nullptr ? *history : std::vector<std::string*>());
+
+  if (fclose(file) || !isWritten)
+  {
+    remove(temporaryPath.c_str());
+    return false;
+  }
+
+  // fat can't rename over an existing file, the previous snapshot is removed only once the new one is complete
+  if (rename(temporaryPath.c_str(), path.c_str()) && (remove(path.c_str()) || rename(temporaryPath.c_str(), path.c_str())))
+    return false;
+
+  return true;
+}
+
+NScript::Node NScript::Evaluator::materialize(const Node& value)
+{
+  if (value.kind != NodeKind::LazyString && value.kind != NodeKind::StringSlice)
+    return value;
+
+  auto isLazy  = value.kind == NodeKind::LazyString;
+  auto length  = isLazy ? value.value.lazy->size : value.value.slice->length;
+  auto content = allocateString(length, value.pos);
+
+  if (!content)
+    return Node::none(value.pos);
+
+  // the file may have shrunk after it was read
+  if (isLazy)
+    content[length = pageCache.read(*value.value.lazy, 0, length, content)] = '\0';
+  else
+    memcpy(content, value.value.slice->data, length);
+
+  return makeString(content, length, isBinary(value), value.pos);
+}
+
+char* NScript::Evaluator::allocateString(uint64_t length, Position pos)
+{
+  if (!expectBudget(length + 1, pos))
+    return nullptr;
+
+  auto scope   = AllocationScope(AllocationCategory::Strings);
+  auto content = new char[length + 1];
+
+  content[length] = '\0';
+  return content;
+}
+
+bool NScript::Evaluator::writeString(const Node& value, FILE* file)
+{
+  if (value.kind == NodeKind::String)
+    return fputs(value.value.str, file) >= 0;
+
+  if (value.kind == NodeKind::StringSlice || value.kind == NodeKind::Bytes)
+    return fwrite(value.value.slice->data, 1, value.value.slice->length, file) == value.value.slice->length;
+
+  char     chunk[lazyPageSize];
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  // one page at a time, the string never needs to be whole in memory
+  for (; (length = pageCache.read(*value.value.lazy, offset, lazyPageSize, chunk)) > 0; offset += length)
+    if (fwrite(chunk, 1, length, file) != length)
+      return false;
+
+  return offset == value.value.lazy->size;
+}
+
+void NScript::Evaluator::printResult(const Node& value)
+{
+  if (value.kind != NodeKind::LazyString)
+  {
+    fiprintf(output, "%s", value.toString().c_str());
+    return;
+  }
+
+  char     chunk[lazyPageSize];
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  // printed the same way of a plain string, but one page at a time
+  fiprintf(output, "'");
+
+  for (; (length = pageCache.read(*value.value.lazy, offset, lazyPageSize, chunk)) > 0; offset += length)
+    fiprintf(output, "%s", Lexer::escapedToEscapes(std::string(chunk, length)).c_str());
+
+  fiprintf(output, "'");
+}
+
+bool NScript::Evaluator::expectBudget(uint64_t bytes, Position pos)
+{
+  auto used = allocationCounter.totalLiveBytes;
+
+  if (used + bytes <= memoryBudget)
+    return true;
+
+  auto left = used < memoryBudget ? memoryBudget - used : 0;
+
+  raise({"not enough memory (`", std::to_string(bytes), "` bytes needed, `", std::to_string(left), "` left in the budget)"}, pos);
+  return false;
+}
+
+bool NScript::Evaluator::expectFilesystem(Position pos)
+{
+  if (!mountFilesystem())
+  {
+    raise({"unable to mount the fat filesystem"}, pos);
+    return false;
+  }
+
+  return true;
+}
+
+NScript::Node NScript::Evaluator::raiseOutOfMemory(Position pos)
+{
+  // the values allocated so far are still valid, only the node being evaluated is discarded
+  allocationCounter.isOutOfMemory = false;
+  reserveEmergencyMemory();
+
+  return raise({"out of memory"}, pos);
+}
+
+void NScript::Evaluator::builtinHead(const CallNode& call)
+{
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  auto file  = expectFile(call.args[0]);
+  auto count = expectCount(evaluateNode(call.args[1]));
+
+  if (failed())
+  {
+    if (file)
+      fclose(file);
+
+    return;
+  }
+
+  // the same stages of `read(path) | head(n)`, the file is closed by the stream
+  auto lines = HeadStream(new FileLinesStream(file), uint64_t(count.value.num));
+  char line[streamLineSize];
+
+  while (lines.nextLine(line))
+    fiprintf(output, "%s\n", line);
+}
+
+void NScript::Evaluator::builtinTail(const CallNode& call)
+{
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  auto file  = expectFile(call.args[0]);
+  auto count = expectCount(evaluateNode(call.args[1]));
+
+  if (failed() || uint64_t(count.value.num) == 0)
+  {
+    if (file)
+      fclose(file);
+
+    return;
+  }
+
+  char buffer[tailBlockSize];
+
+  fseek(file, 0, SEEK_END);
+
+  uint64_t end            = ftell(file);
+  uint64_t start          = 0;
+  uint64_t neededNewlines = count.value.num;
+  auto     isTerminated   = end > 0 && !fseek(file, -1, SEEK_END) && getc(file) == '\n';
+
+  // the terminator of the last line does not start a new line
+  if (isTerminated)
+    neededNewlines++;
+
+  // reading blocks backwards from the end, until the first printed line is found
+  for (auto blockEnd = end; blockEnd > 0 && start == 0;)
+  {
+    auto blockStart = blockEnd > tailBlockSize ? blockEnd - tailBlockSize : 0;
+    auto length     = blockEnd - blockStart;
+
+    fseek(file, blockStart, SEEK_SET);
+    length = fread(buffer, 1, length, file);
+
+    for (auto i = length; i > 0; i--)
+      if (buffer[i - 1] == '\n' && --neededNewlines == 0)
+      {
+        start = blockStart + i;
+        break;
+      }
+
+    blockEnd = blockStart;
+  }
+
+  fseek(file, start, SEEK_SET);
+
+  // printing the lines as they are
+  for (auto length = fread(buffer, 1, tailBlockSize, file); length > 0; length = fread(buffer, 1, tailBlockSize, file))
+    fwrite(buffer, 1, length, output);
+
+  // the last line may have no terminator
+  if (!isTerminated && end > 0)
+    fiprintf(output, "\n");
+
+  fclose(file);
+}
+
+void NScript::Evaluator::builtinHexdump(const CallNode& call)
+{
+  expectArgsCount(call, 3);
+
+  if (failed())
+    return;
+
+  auto file   = expectFile(call.args[0]);
+  auto offset = expectCount(evaluateNode(call.args[1]));
+  auto length = expectCount(evaluateNode(call.args[2]));
+
+  if (failed())
+  {
+    if (file)
+      fclose(file);
+
+    return;
+  }
+
+  if (fseek(file, uint64_t(offset.value.num), SEEK_SET))
+  {
+    fclose(file);
+    raise({"unable to seek to offset `", offset.toString(), "`"}, offset.pos);
+    return;
+  }
+
+  uint8_t row[hexdumpRowSize];
+  auto    rowOffset = uint64_t(offset.value.num);
+  auto    remaining = uint64_t(length.value.num);
+
+  // each line is `offset hex ascii`, such as `000010 48656c6c6f0a0000 Hello...`
+  while (remaining > 0)
+  {
+    auto read = fread(row, 1, std::min(remaining, hexdumpRowSize), file);
+
+    if (read == 0)
+      break;
+
+    fiprintf(output, "%06lx ", (unsigned long)rowOffset);
+
+    // the last row is padded, so that its chars are aligned with the others
+    for (uint64_t i = 0; i < hexdumpRowSize; i++)
+      if (i < read)
+        fiprintf(output, "%02x", row[i]);
+      else
+        fiprintf(output, "  ");
+
+    fiprintf(output, " ");
+
+    for (uint64_t i = 0; i < read; i++)
+      fiprintf(output, "%c", row[i] >= ' ' && row[i] <= '~' ? row[i] : '.');
+
+    fiprintf(output, "\n");
+
+    rowOffset += read;
+    remaining -= read;
+  }
+
+  fclose(file);
+}
+
+FILE* NScript::Evaluator::expectFile(const Node& arg)
+{
+  auto path = expectPath(arg, true);
+
+  if (failed())
+    return nullptr;
+
+  auto file = fopen(path.c_str(), "rb");
+
+  if (!file)
+    raise({"unable to open file `", path, "`"}, arg.pos);
+
+  return file;
+}
+
+void NScript::Evaluator::builtinCopy(const CallNode& call)
+{
+  auto source      = std::string();
+  auto destination = std::string();
+  auto isDir       = false;
+
+  expectSourceAndDestinationPaths(call, source, destination, isDir);
+
+  if (failed() || !expectBudget(copyBlockSize, call.name.pos))
+    return;
+
+  auto failures = copyPath(source, destination, isDir);
+
+  if (failures > 0)
+    raise({"unable to copy `", std::to_string(failures), "` entries of `", source, "`"}, call.args[0].pos);
+}
+
+void NScript::Evaluator::builtinMove(const CallNode& call)
+{
+  auto source      = std::string();
+  auto destination = std::string();
+  auto isDir       = false;
+
+  expectSourceAndDestinationPaths(call, source, destination, isDir);
+
+  if (failed())
+    return;
+
+  // on the same volume only the directory entry changes
+  if (!rename(source.c_str(), destination.c_str()))
+    return;
+
+  if (errno != EXDEV)
+  {
+    raise({"unable to move `", source, "` to `", destination, "`"}, call.args[1].pos);
+    return;
+  }
+
+  if (!expectBudget(copyBlockSize, call.name.pos))
+    return;
+
+  // across volumes the source is removed only once it's completely copied
+  auto failures = copyPath(source, destination, isDir);
+
+  if (failures > 0)
+  {
+    raise({"unable to copy `", std::to_string(failures), "` entries of `", source, "`, the source is left untouched"}, call.args[0].pos);
+    return;
+  }
+
+  if (isDir ? removeAllInsideDir(addTrailingSlashToPath(source)) > 0 || rmdir(source.c_str()) : remove(source.c_str()))
+    raise({"copied to `", destination, "` but unable to delete `", source, "`"}, call.args[0].pos);
+}
+
+void NScript::Evaluator::expectSourceAndDestinationPaths(const CallNode& call, std::string& source, std::string& destination, bool& isDir)
+{
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  // the paths are handled without trailing slash, they are added only when walking folders
+  source      = removeTrailingSlashFromPath(expectPath(call.args[0], true));
+  destination = removeTrailingSlashFromPath(expectPath(call.args[1], true));
+
+  if (failed())
+    return;
+
+  struct stat info;
+
+  if (stat(source.c_str(), &info))
+  {
+    raise({"unable to find `", source, "`"}, call.args[0].pos);
+    return;
+  }
+
+  isDir = S_ISDIR(info.st_mode);
+
+  auto sourceInfo = info;
+
+  // `copy('a.txt', 'folder')` -> `folder/a.txt`
+  if (!stat(destination.c_str(), &info) && S_ISDIR(info.st_mode))
+    destination = addTrailingSlashToPath(destination) + getPathName(source);
+
+  // the destination is truncated before the source is read, a file copied onto itself would be lost
+  // (the paths are not normalized, so the existing destination is also compared by its inode, which is 0 for the empty files of fat)
+  if (!isDir && (destination == source || (!stat(destination.c_str(), &info) && info.st_ino != 0 && info.st_ino == sourceInfo.st_ino && info.st_dev == sourceInfo.st_dev)))
+  {
+    raise({"source and destination are the same file"}, call.args[1].pos);
+    return;
+  }
+
+  if (isDir && addTrailingSlashToPath(destination).compare(0, source.length() + 1, addTrailingSlashToPath(source)) == 0)
+    raise({"unable to copy or move folder `", source, "` inside itself"}, call.args[1].pos);
+}
+
+uint64_t NScript::Evaluator::copyPath(const std::string& source, const std::string& destination, bool isDir)
+{
+  if (!isDir)
+  {
+    if (copyFile(source.c_str(), destination.c_str()))
+      return 0;
+
+    fiprintf(output, "unable to copy `%s`\n", source.c_str());
+    return 1;
+  }
+
+  if (mkdir(destination.c_str(), S_IRUSR) && errno != EEXIST)
+  {
+    fiprintf(output, "unable to make folder `%s`\n", destination.c_str());
+    return 1;
+  }
+
+  // the walked paths are mapped to the destination by replacing the source's prefix
+  auto     sourceRoot      = addTrailingSlashToPath(source);
+  auto     destinationRoot = addTrailingSlashToPath(destination);
+  auto     walker          = DirWalker(sourceRoot.c_str());
+  uint64_t failures        = 0;
+
+  while (walker.next())
+  {
+    auto entryDestination = destinationRoot + (walker.getPath() + sourceRoot.length());
+    auto isCopied         = true;
+
+    switch (walker.event)
+    {
+      case WalkEvent::File:     isCopied = copyFile(walker.getPath(), entryDestination.c_str()); break;
+      case WalkEvent::EnterDir: isCopied = !mkdir(entryDestination.c_str(), S_IRUSR) || errno == EEXIST; break;
+      case WalkEvent::Error:    isCopied = false; break;
+      case WalkEvent::LeaveDir: break;
+    }
+
+    if (!isCopied)
+    {
+      fiprintf(output, "unable to copy `%s`\n", walker.getPath());
+      failures++;
+    }
+  }
+
+  return failures;
+}
+
+void NScript::Evaluator::builtinMkDir(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  const auto& arg = call.args[0];
+  auto path       = expectPath(arg, false);
+
+  if (failed())
+    return;
+
+  if (mkdir(path.c_str(), S_IRUSR))
+    raise({"unable to make folder `", path, "`"}, arg.pos);
+}
+
+void NScript::Evaluator::builtinRmFile(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  const auto& arg = call.args[0];
+  auto path       = expectPath(arg, true);
+
+  if (failed())
+    return;
+
+  // all the matching files are removed during a single walk
+  if (Glob::hasWildcards(path))
+  {
+    uint64_t failures = 0;
+
+    forEachGlobMatch(path, arg.pos, true, false, [this, &failures] (cstring_t matchedPath) {
+      if (!remove(matchedPath))
+        return true;
+
+      fiprintf(output, "unable to delete `%s`\n", matchedPath);
+      failures++;
+      return false;
+    });
+
+    if (!failed() && failures > 0)
+      raise({"unable to delete `", std::to_string(failures), "` of the matching files"}, arg.pos);
+
+    return;
+  }
+
+  if (remove(path.c_str()))
+    raise({"unable to delete file `", path, "`"}, arg.pos);
+}
+
+void NScript::Evaluator::builtinWrite(const CallNode& call)
+{
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  const auto& arg  = call.args[0];
+  const auto& arg2 = call.args[1];
+  auto path        = expectPath(arg, true);
+  auto content     = evaluateNode(arg2);
+
+  if (failed())
+    return;
+
+  // opening the file truncates it, a lazy string of the same file must be loaded before (any matching file may be the same one)
+  if (content.kind == NodeKind::LazyString && (content.value.lazy->path == path || Glob::hasWildcards(path)))
+    content = materialize(content);
+  else if (!isStringKind(content.kind))
+    expectType(content, NodeKind::String);
+
+  if (failed())
+    return;
+
+  // `write('logs/*.txt', '')` overwrites all the matching files
+  if (Glob::hasWildcards(path))
+  {
+    uint64_t failures = 0;
+
+    forEachGlobMatch(path, arg.pos, true, false, [this, &content, &failures] (cstring_t matchedPath) {
+      auto file      = fopen(matchedPath, "wb");
+      auto isWritten = file && writeString(content, file);
+
+      if ((file && fclose(file)) || !isWritten)
+      {
+        fiprintf(output, "unable to write `%s`\n", matchedPath);
+        failures++;
+      }
+
+      return false;
+    });
+
+    if (!failed() && failures > 0)
+      raise({"unable to write `", std::to_string(failures), "` of the matching files"}, arg.pos);
+
+    return;
+  }
+
+  auto file = fopen(path.c_str(), "wb");
+
+  if (!file)
+  {
+    raise({"unable to make file `", path, "`"}, arg.pos);
+    return;
+  }
+  
+  auto isWritten = writeString(content, file);
+
+  if (fclose(file) || !isWritten)
+    raise({"unable to write file `", path, "`"}, arg.pos);
+}
+
+NScript::Node NScript::Evaluator::builtinRead(const CallNode& call, Position pos)
+{
+  if (call.args.size() != 2)
+    expectArgsCount(call, 1);
+
+  if (failed())
+    return Node::none(pos);
+
+  const auto& arg = call.args[0];
+  auto path       = expectPath(arg, true);
+  auto isBinary   = false;
+
+  if (call.args.size() == 2)
+  {
+    auto mode = expectStringLengthAndGetString(evaluateNode(call.args[1]), [] (uint64_t l) { return true; });
+
+    if (!failed() && strcmp(mode, "b"))
+      return raise({"unknown read mode `", mode, "` (expected `b`)"}, call.args[1].pos);
+
+    isBinary = true;
+  }
+
+  if (failed())
+    return Node::none(pos);
+
+  auto file = fopen(path.c_str(), "rb");
+
+  if (!file)
+    return raise({"unable to open file `", path, "`"}, arg.pos);
+
+  fseek(file, 0, SEEK_END);
+
+  uint64_t size = ftell(file);
+
+  // big files are loaded only when (and where) they are accessed
+  if (size >= lazyReadThreshold)
+  {
+    auto scope = AllocationScope(AllocationCategory::Strings);
+
+    fclose(file);
+    return Node(NodeKind::LazyString, (NodeValue) { .lazy = new LazyFile(path, size, isBinary) }, pos);
+  }
+
+  if (!expectBudget(size + 1, pos))
+  {
+    fclose(file);
+    return Node::none(pos);
+  }
+
+  auto scope   = AllocationScope(AllocationCategory::Strings);
+  auto content = new char[size + 1];
+
+  fseek(file, 0, SEEK_SET);
+
+  auto length = fread(content, 1, size, file);
+
+  content[length] = '\0';
+  fclose(file);
+
+  // a text file holding null chars is returned as bytes as well
+  return makeString(content, length, isBinary, pos);
+}
+
+void NScript::Evaluator::builtinGrep(const CallNode& call)
+{
+  expectArgsCount(call, 2);
+
+  if (failed())
+    return;
+
+  auto grep       = expectGrepPattern(call.args[0]);
+  const auto& arg = call.args[1];
+  auto path       = expectNonEmptyStringAndGetString(evaluateNode(arg));
+
+  if (failed() || !expectBudget(grepBlockSize, call.name.pos))
+    return;
+
+  auto fullPath = getFullPath(path, true);
+  struct stat info;
+
+  if (stat(fullPath.c_str(), &info))
+  {
+    raise({"unable to find `", fullPath, "`"}, arg.pos);
+    return;
+  }
+
+  // a directory is searched recursively, the matches are prefixed with the path of their file
+  if (S_ISDIR(info.st_mode))
+  {
+    grep.searchDirectory(addTrailingSlashToPath(fullPath).c_str());
+    return;
+  }
+
+  auto file = fopen(fullPath.c_str(), "rb");
+
+  if (!file)
+  {
+    raise({"unable to open file `", fullPath, "`"}, arg.pos);
+    return;
+  }
+
+  grep.searchFile(file, nullptr);
+  fclose(file);
+}
+
+void NScript::Evaluator::forEachGlobMatch(const std::string& pattern, Position pos, bool shouldMatchFiles, bool shouldMatchDirs, std::function<bool(cstring_t path)> action)
+{
+  auto glob = Glob(pattern);
+
+  if (glob.compileError)
+  {
+    raise({"invalid glob: ", glob.compileError}, pos);
+    return;
+  }
+
+  // the matching state of each folder being walked, the root's one first
+  auto     walker  = DirWalker(glob.root.c_str());
+  auto     states  = std::vector<uint64_t>({ glob.getStartStates() });
+  uint64_t matches = 0;
+
+  while (walker.next())
+  {
+    if (walker.event == WalkEvent::LeaveDir)
+    {
+      states.pop_back();
+      continue;
+    }
+
+    if (walker.event == WalkEvent::Error)
+    {
+      // a folder which could not be opened has no LeaveDir, the state pushed when entering it is dropped here
+      states.resize(walker.getDepth() + 1);
+      fiprintf(output, "unable to visit `%s`\n", walker.getPath());
+      continue;
+    }
+
+    auto isDir     = walker.event == WalkEvent::EnterDir;
+    auto name      = walker.getName();
+    auto next      = glob.step(states[walker.getDepth()], name, strlen(name) - (isDir ? 1 : 0));
+    auto isMatch   = glob.isMatch(next) && (isDir ? shouldMatchDirs : shouldMatchFiles);
+    auto isRemoved = false;
+
+    if (isMatch)
+    {
+      matches++;
+
+      if (isDryRun)
+        fiprintf(output, "%s\n", getDisplayedPath(walker.getPath()));
+      else
+        isRemoved = action(walker.getPath());
+    }
+
+    if (isRemoved)
+      walker.entryRemoved();
+
+    if (!isDir)
+      continue;
+
+    // the folders which can't contain any match are never read
+    if (isRemoved || !glob.canDescend(next) || (isMatch && !shouldMatchFiles))
+      walker.skipDir();
+    else
+      states.push_back(next);
+  }
+
+  if (matches == 0)
+    raise({"nothing matches `", pattern, "`"}, pos);
+  else if (isDryRun)
+    fiprintf(output, "%lu matches (dry run)\n", (unsigned long)matches);
+}
+
+void NScript::Evaluator::builtinDryRun(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  auto flag = expectType(evaluateNode(call.args[0]), NodeKind::Num);
+
+  if (!failed())
+    isDryRun = flag.value.num != 0;
+}
+
+void NScript::Evaluator::builtinFind(const CallNode& call)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return;
+
+  auto grep   = expectGrepPattern(call.args[0]);
+  auto walker = DirWalker(cwd.c_str());
+
+  if (failed())
+    return;
+
+  while (walker.next())
+  {
+    // the paths are printed relative to the cwd
+    auto relativePath = walker.getPath() + cwd.length();
+
+    switch (walker.event)
+    {
+      case WalkEvent::File:
+      case WalkEvent::EnterDir:
+      {
+        auto name   = walker.getName();
+        auto length = strlen(name);
+
+        // folders are matched without their trailing `/`
+        if (grep.matchesLine(name, walker.event == WalkEvent::EnterDir ? length - 1 : length))
+          fiprintf(output, "%s\n", relativePath);
+
+        break;
+      }
+
+      case WalkEvent::Error:
+        fiprintf(output, "unable to visit `%s`\n", relativePath);
+        break;
+
+      case WalkEvent::LeaveDir:
+        break;
+    }
+  }
+}
+
+NScript::Node NScript::Evaluator::builtinDu(const CallNode& call, Position pos)
+{
+  expectArgsCount(call, 1);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto path = expectDirPath(call.args[0]);
+
+  if (failed())
+    return Node::none(pos);
+
+  auto     walker = DirWalker(path.c_str());
+  uint64_t size   = 0;
+  struct stat info;
+
+  while (walker.next())
+    if (walker.event == WalkEvent::File && !stat(walker.getPath(), &info))
+      size += info.st_size;
+    else if (walker.event == WalkEvent::Error)
+      fiprintf(output, "unable to visit `%s`\n", walker.getPath());
+
+  return Node(NodeKind::Num, (NodeValue) { .num = float64(size) }, pos);
+}
+
+std::string NScript::Evaluator::expectDirPath(const Node& arg)
+{
+  auto path = expectPath(arg, false);
+
+  if (failed())
+    return path;
+
+  struct stat info;
+
+  if (stat(path.c_str(), &info) || !S_ISDIR(info.st_mode))
+    raise({"unable to find folder `", path, "`"}, arg.pos);
+
+  return path;
+}
+
+NScript::Grep NScript::Evaluator::expectGrepPattern(const Node& arg)
+{
+  auto pattern = expectStringLengthAndGetString(evaluateNode(arg), [] (uint64_t l) { return true; });
+  auto grep    = Grep(failed() ? "" : pattern);
+
+  grep.output = output;
+
+  if (grep.compileError)
+    raise({"invalid pattern: ", grep.compileError}, arg.pos);
+
+  return grep;
+}
+
+cstring_t NScript::Evaluator::expectNonEmptyStringAndGetString(const Node& node)
+{
+  return expectStringLengthAndGetString(node, [] (uint64_t l) { return l > 0; });
+}
+
+std::string NScript::Evaluator::expectPath(const Node& arg, bool shouldBeFile)
+{
+  auto path = expectNonEmptyStringAndGetString(evaluateNode(arg));
+
+  if (failed())
+    return std::string();
+
+  return getFullPath(path, shouldBeFile);
 }
 
 std::string NScript::Evaluator::getFullPath(std::string path, bool shouldBeFile)
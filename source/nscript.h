@@ -9,13 +9,22 @@
 #include <dirent.h>
 
 #include "basics.h"
+#include "grep.h"
+#include "lazy.h"
+#include "glob.h"
+#include "lz77.h"
+#include "checksum.h"
 
 namespace NScript
 {
+  // positions are 16 bits wide, the eof token takes one more char after the end of the expression
+  const uint64_t maxExpressionLength = UINT16_MAX - 1;
+
+  // span of a node inside the prompt, kept small since every node of a tree carries one
   class Position
   {
-    public: uint64_t startPos;
-    public: uint64_t endPos;
+    public: uint16_t startPos;
+    public: uint16_t endPos;
 
     public: Position(uint64_t startPos, uint64_t endPos)
     {
@@ -28,23 +37,27 @@ namespace NScript
       *this = Position(0, 0);
     }
 
-    public: inline uint64_t length()
+    public: inline uint64_t length() const
     {
       return endPos - startPos;
     }
   };
 
-  enum class NodeKind
+  enum class NodeKind : uint8_t
   {
     Bin,
     Una,
     Call,
     Assign,
+    Def,
     Bad,
     Eof,
     None,
     Num,
     String,
+    LazyString,  // a string whose content is still inside a file, the evaluator loads it when it's accessed
+    StringSlice, // a part of another string, it shares its buffer
+    Bytes,       // a binary buffer which carries its length (it may contain null chars), its slices share its buffer
     Identifier,
     Plus  = '+',
     Minus = '-',
@@ -54,12 +67,38 @@ namespace NScript
     RPar  = ')',
     Comma = ',',
     Eq    = '=',
+    Pipe  = '|',
   };
 
+  // rmdir prints how many entries it removed every time this count is reached
+  const uint64_t rmdirProgressInterval = 256;
+
+  // tail reads the file backwards in blocks of this size, until it finds enough lines
+  const uint64_t tailBlockSize = 4096;
+
+  // bytes shown in each line of hexdump (the line is exactly as wide as the console)
+  const uint64_t hexdumpRowSize = 8;
+
+  // how many frames the warning of a shutdown without saving stays on screen
+  const uint64_t shutdownWarningFrames = 120;
+
+  // user functions can't nest deeper than this, each call also takes some native stack, which is very small on the ds
+  const uint64_t maxCallDepth = 64;
+
+  // the args of all the nested calls share this many slots, they are reserved once
+  const uint64_t maxFrameSlots = 256;
+
+  // how many live bytes the evaluator can use by default (the ds has 4MB of main ram, shared with the code and the libraries)
+  const uint64_t defaultMemoryBudget = 2 * 1024 * 1024;
+
   class BinNode;
   class UnaNode;
+  class Stream;
   class CallNode;
   class AssignNode;
+  class DefNode;
+  class LazyFile;
+  class StringSlice;
   
   union NodeValue
   {
@@ -69,14 +108,18 @@ namespace NScript
     public: UnaNode*    una;
     public: CallNode*   call;
     public: AssignNode* assign;
+    public: DefNode*    def;
+    public: LazyFile*   lazy;
+    public: StringSlice* slice; // also the buffer of bytes
     public: void_t      none;
   };
 
+  // 16 bytes: the value first, so that the span and the kind share its alignment padding
   class Node
   {
-    public: NodeKind  kind;
     public: NodeValue value;
     public: Position  pos;
+    public: NodeKind  kind;
 
     public: Node(NodeKind kind, NodeValue value, Position pos)
     {
@@ -110,11 +153,15 @@ namespace NScript
       switch (kind)
       {
         case NodeKind::Num:         return "num";
-        case NodeKind::String:      return "str";
+        case NodeKind::String:
+        case NodeKind::LazyString:
+        case NodeKind::StringSlice: return "str";
+        case NodeKind::Bytes:       return "bytes";
         case NodeKind::Bin:         return "bin";
         case NodeKind::Una:         return "una";
         case NodeKind::Call:        return "call";
         case NodeKind::Assign:      return "assign";
+        case NodeKind::Def:         return "def";
         case NodeKind::None:        return "none";
         case NodeKind::Plus:
         case NodeKind::Minus:
@@ -123,6 +170,7 @@ namespace NScript
         case NodeKind::RPar:
         case NodeKind::Comma:
         case NodeKind::Eq:
+        case NodeKind::Pipe:
         case NodeKind::Slash:       return std::string(1, char(kind));
         case NodeKind::Identifier:  return "id";
         case NodeKind::Bad:         return "<bad>";
@@ -133,29 +181,32 @@ namespace NScript
       return nullptr;
     }
 
-    public: std::string toString();
+    public: std::string toString() const;
   };
 
+  // the operator is stored inline, its token is always a single char
   class BinNode
   {
-    public: Node left;
-    public: Node right;
-    public: Node op;
+    public: Node     left;
+    public: Node     right;
+    public: Position opPos;
+    public: NodeKind op;
 
-    public: BinNode(Node left, Node right, Node op)
+    public: BinNode(Node left, Node right, NodeKind op, Position opPos)
     {
       this->left  = left;
       this->right = right;
+      this->opPos = opPos;
       this->op    = op;
     }
   };
 
   class UnaNode
   {
-    public: Node term;
-    public: Node op;
+    public: Node     term;
+    public: NodeKind op;
 
-    public: UnaNode(Node term, Node op)
+    public: UnaNode(Node term, NodeKind op)
     {
       this->term = term;
       this->op   = op;
@@ -186,7 +237,37 @@ namespace NScript
     }
   };
 
-  class Error : std::exception
+  // `def name(params) = body`
+  class DefNode
+  {
+    public: Node              name;
+    public: std::vector<Node> params;
+    public: Node              body;
+    public: std::string       source; // the text of the def, the snapshots save it instead of the tree
+
+    public: DefNode(Node name, std::vector<Node> params, Node body, std::string source)
+    {
+      this->name   = name;
+      this->params = params;
+      this->body   = body;
+      this->source = source;
+    }
+  };
+
+  // a string which carries its length, it's not null terminated
+  class StringSlice
+  {
+    public: const char* data;
+    public: uint64_t    length;
+
+    public: StringSlice(const char* data, uint64_t length)
+    {
+      this->data   = data;
+      this->length = length;
+    }
+  };
+
+  class Error
   {
     public: std::vector<std::string> message;
     public: Position                 position;
@@ -196,76 +277,79 @@ namespace NScript
       this->message  = message;
       this->position = position;
     }
+
+    public: Error()
+    {
+      *this = Error({}, Position());
+    }
   };
 
-  class Parser
+  // exception-free error channel of the parser and the evaluator (the project builds with `-fno-exceptions`)
+  // the first raised error is kept in the slot, every caller checks `failed()` and returns early
+  class ErrorSlot
   {
-    private: std::string expression;
-    private: uint64_t    exprIndex;
-    private: Node        curToken;
-    private: Node        prevToken;
+    public: Error error;
+    private: bool hasFailed = false;
 
-    public: Parser(std::string expression)
+    public: inline bool failed() const
     {
-      this->expression = expression;
-      this->exprIndex  = 0;
+      return hasFailed;
     }
 
-    public: inline Node parse()
+    public: inline void clearError()
     {
-      // fetching the first token
-      advance();
-
-      // the main expression
-      auto expr = expectExpression();
+      error     = Error();
+      hasFailed = false;
+    }
 
-      // the main expression is not alone in the prompt
-      expectTokenAndAdvance(NodeKind::Eof);
+    // returns a bad node, so the caller can propagate it as its own result
+    public: inline Node raise(std::vector<std::string> message, Position position)
+    {
+      // the following errors are only consequences of the first one
+      if (!hasFailed)
+      {
+        error     = Error(message, position);
+        hasFailed = true;
+      }
 
-      return expr;
+      return Node::bad("<error>", position);
     }
+  };
 
-    private: inline Node expectExpression()
+  class Lexer : public ErrorSlot
+  {
+    private: std::string expression;
+    private: uint64_t    exprIndex;
+
+    public: Lexer(std::string expression)
     {
-      // expression     = sub_expression +|- sub_expression ...
-      // sub_expression = term           *|/ term           ...
-      // term           = id|num|str
-      return expectBinaryOrTerm([this] {
-        return expectBinaryOrTerm([this] {
-          return expectTerm();
-        }, { NodeKind::Star, NodeKind::Slash });
-      }, { NodeKind::Plus, NodeKind::Minus });
+      this->expression = expression;
+      this->exprIndex  = 0;
     }
 
-    private: inline Node expectTokenAndAdvance(NodeKind kind)
+    public: Lexer()
     {
-      if (curToken.kind != kind)
-        throw Error({"expected `", Node::kindToString(kind), "` (found `", curToken.toString(), "`)"}, curToken.pos);
-      
-      advance();
-
-      return prevToken;
+      *this = Lexer("");
     }
 
-    private: template<typename T> inline bool arrayContains(std::vector<T> array, T elem)
+    // the part of the expression inside `pos`
+    public: inline std::string getText(Position pos)
     {
-      for (const auto& e : array)
-        if (e == elem)
-          return true;
-
-      return false;
+      return expression.substr(pos.startPos, pos.endPos - pos.startPos);
     }
 
-    private: Node expectBinaryOrTerm(std::function<Node()> expector, std::vector<NodeKind> operators);
-
-    private: inline Node advance()
+    // continues lexing the (edited) expression from `index`
+    public: inline void restart(std::string expression, uint64_t index)
     {
-      prevToken = curToken;
-      curToken  = nextToken();
+      this->expression = expression;
+      this->exprIndex  = index;
 
-      return curToken;
+      clearError();
     }
 
+    // when `failed()` after collecting a token, the returned token is not meaningful
+    public: Node nextToken();
+
     private: inline char curChar(uint64_t count = 0)
     {
       return expression[exprIndex + count];
@@ -276,11 +360,6 @@ namespace NScript
       return Position(exprIndex + count, exprIndex + count + 1);
     }
 
-    private: inline bool eofToken()
-    {
-      return curToken.kind == NodeKind::Eof;
-    }
-
     private: inline bool eof(uint64_t count = 0)
     {
       return exprIndex + count >= expression.length();
@@ -315,21 +394,25 @@ namespace NScript
         exprIndex++;
     }
 
-    private: inline Node getCurAndAdvance()
+    // returns the value of a digit in base 16 or lower, or 255 when `c` is not a digit
+    private: static inline uint8_t radixDigitValue(char c)
     {
-      advance();
+      if (c >= '0' && c <= '9')
+        return c - '0';
 
-      return prevToken;
+      if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+      if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+      return 255;
     }
-    
-    private: inline uint64_t countOccurrences(std::string s, char toCheck)
-    {
-      uint64_t t = 0;
 
-      for (const auto& c : s)
-        t += !!(c == toCheck);
-      
-      return t;
+    // returns true when the current char is a `_` between two digits of the same number (`1_000`, `0xff_ff`)
+    private: inline bool isDigitSeparator(uint8_t radix)
+    {
+      return curChar() == '_' && radixDigitValue(curChar(-1)) < radix && !eof(+1) && radixDigitValue(curChar(+1)) < radix;
     }
 
     private: inline char escapeChar(char c, Position pos)
@@ -342,7 +425,7 @@ namespace NScript
         case 'n':  return '\n';
         case 't':  return '\t';
         case '0':  return '\0';
-        default:   throw Error({"unknown escaped char `\\", std::string(1, c), "`"}, pos);
+        default:   raise({"unknown escaped char `\\", std::string(1, c), "`"}, pos); return c;
       }
     }
 
@@ -356,8 +439,18 @@ namespace NScript
         case '\n': return "\\n";
         case '\t': return "\\t";
         case '\0': return "\\0";
-        default:   return std::string(1, c);
       }
+
+      // the other control chars and the non ascii bytes are shown in hex (`\x1b`)
+      if (uint8_t(c) < ' ' || uint8_t(c) >= 0x7F)
+      {
+        char hex[5];
+
+        snprintf(hex, sizeof(hex), "\\x%02x", uint8_t(c));
+        return hex;
+      }
+
+      return std::string(1, c);
     }
 
     public: inline static std::string escapedToEscapes(std::string s)
@@ -370,10 +463,6 @@ namespace NScript
       return t;
     }
 
-    private: Node collectCallNode(Node name);
-
-    private: Node expectTerm();
-
     private: std::string collectSequence(std::function<bool()> checker);
 
     private: Node collectIdentifierToken();
@@ -382,74 +471,429 @@ namespace NScript
 
     private: Node collectNumToken();
 
+    private: Node collectRadixNumToken(uint8_t radix);
+
+    private: float64 decimalToFloat64(uint64_t mantissa, int64_t exponent, bool isTruncated, Position pos);
+
     private: std::string escapesToEscaped(std::string s, Position pos);
     
     private: Node collectStringToken();
+  };
+
+  class Parser : public ErrorSlot
+  {
+    private: Lexer                                  lexer;
+    private: std::vector<Node>                      tokens;     // lexed tokens, the last one is `eof` once the whole expression is lexed
+    private: std::vector<KeyPair<uint64_t, Error>> lexErrors;  // errors raised by the lexer, by token index (raised when the parser reaches them)
+    private: uint64_t                               tokenIndex;
+    private: Node                                   curToken;
+    private: Node                                   prevToken;
+
+    public: Parser(std::string expression)
+    {
+      this->lexer      = Lexer(expression);
+      this->tokens     = std::vector<Node>();
+      this->lexErrors  = std::vector<KeyPair<uint64_t, Error>>();
+      this->tokenIndex = 0;
+    }
+
+    public: Parser()
+    {
+      *this = Parser("");
+    }
+
+    // when `failed()` after parsing, the returned node is not meaningful
+    public: inline Node parse()
+    {
+      auto scope = AllocationScope(AllocationCategory::Ast);
+
+      // lexing what is left of the expression
+      lex(UINT64_MAX);
+
+      // the same tokens can be parsed again after an edit
+      clearError();
+      tokenIndex = 0;
 
-    private: Node nextToken();
+      // fetching the first token
+      advance();
+
+      // the main expression
+      auto expr = expectExpression();
+
+      if (failed())
+        return expr;
+
+      // the main expression is not alone in the prompt
+      expectTokenAndAdvance(NodeKind::Eof);
+
+      return expr;
+    }
+
+    public: inline bool isLexed()
+    {
+      return !tokens.empty() && tokens.back().kind == NodeKind::Eof;
+    }
+
+    public: inline const std::vector<Node>& getTokens()
+    {
+      return tokens;
+    }
+
+    // lexes at most `maxTokens` tokens, returns true when the whole expression is lexed
+    public: bool lex(uint64_t maxTokens);
+
+    // replaces the expression after it was edited starting from `editedIndex`,
+    // the tokens before the edit are kept, the others will be lexed again
+    public: void edit(std::string expression, uint64_t editedIndex);
+
+    // frees the inner nodes of a parsed tree (values produced by the evaluator never point to them)
+    public: static void deleteTree(const Node& tree);
+
+    // copies the inner nodes of a tree, so that it outlives the parsed prompt (the strings are shared)
+    public: static Node cloneTree(const Node& tree);
+
+    private: inline Node expectExpression()
+    {
+      // expression     = sum            |   sum            ...
+      // def            = `def` id ( id, ... ) = expression
+      // sum            = sub_expression +|- sub_expression ...
+      // sub_expression = term           *|/ term           ...
+      // term           = id|num|str
+      return expectBinaryOrTerm([this] {
+        return expectBinaryOrTerm([this] {
+          return expectBinaryOrTerm([this] {
+            return expectTerm();
+          }, { NodeKind::Star, NodeKind::Slash });
+        }, { NodeKind::Plus, NodeKind::Minus });
+      }, { NodeKind::Pipe });
+    }
+
+    private: inline Node expectTokenAndAdvance(NodeKind kind)
+    {
+      if (curToken.kind != kind)
+        return raise({"expected `", Node::kindToString(kind), "` (found `", curToken.toString(), "`)"}, curToken.pos);
+      
+      advance();
+
+      return prevToken;
+    }
+
+    private: Node expectBinaryOrTerm(std::function<Node()> expector, std::vector<NodeKind> operators);
+
+    private: Node advance();
+
+    private: inline bool eofToken()
+    {
+      return curToken.kind == NodeKind::Eof;
+    }
+
+    private: inline Node getCurAndAdvance()
+    {
+      advance();
+
+      return prevToken;
+    }
+
+    private: Node collectCallNode(Node name);
+
+    private: Node expectTerm();
 
     private: Node collectAssignNode(Node name);
+
+    private: Node collectDefNode();
   };
 
-  class Evaluator
+  class AstCache;
+  class InputLog;
+
+  class Evaluator : public ErrorSlot
   {
-    public:  std::string                             cwd;       // current working directory
-    public:  std::vector<KeyPair<std::string, Node>> map;       // declared variables map
+    public:  std::string                             cwd;             // current working directory
+    public:  std::vector<KeyPair<std::string, Node>> map;             // declared variables map
+    public:  std::vector<KeyPair<std::string, Node>> functions;       // declared functions, their def nodes are owned by the evaluator
+    public:  uint64_t                                memoryBudget;    // builtins refuse to allocate over it
+    public:  bool                                    isDryRun;        // the builtins taking glob paths only print the entries they would act on
+    private: std::vector<Node>                       frames;          // the args of the calls being evaluated, one call after the other
+    private: uint64_t                                frameBase;       // index in `frames` of the first arg of the current call
+    private: const DefNode*                          currentFunction; // the function being evaluated, null outside of calls
+    private: uint64_t                                callDepth;
+    private: std::vector<Node>                       retiredDefs;     // functions redefined while a call was running, freed once all the calls return
+    private: LazyPageCache                           pageCache;       // the loaded pages of the lazy strings
+    public:  const AstCache*                         astCache;        // the parsed prompts cache of the console, reported by mem()
+    public:  std::vector<std::string*>*              history;         // the prompts of the console, saved and loaded with the session
+    public:  FILE*                                   output;          // where the builtins print, the console on the ds (a file for each script in the host runner)
+    public:  InputLog*                               inputLog;        // the input recorder of the console, driven by `record` and `replay`
 
     public: Evaluator()
     {
-      this->map = std::vector<KeyPair<std::string, Node>>();
-      this->cwd = "/";
+      this->map             = std::vector<KeyPair<std::string, Node>>();
+      this->functions       = std::vector<KeyPair<std::string, Node>>();
+      this->cwd             = "/";
+      this->memoryBudget    = defaultMemoryBudget;
+      this->isDryRun        = false;
+      this->frames          = std::vector<Node>();
+      this->frameBase       = 0;
+      this->currentFunction = nullptr;
+      this->callDepth       = 0;
+      this->retiredDefs     = std::vector<Node>();
+      this->pageCache       = LazyPageCache();
+      this->astCache        = nullptr;
+      this->history         = nullptr;
+      this->output          = stdout;
+      this->inputLog        = nullptr;
+
+      reserveEmergencyMemory();
     }
 
-    public: Node evaluateNode(Node node);
+    // returns true when `name` is one of the builtin functions
+    public: static bool isBuiltin(cstring_t name);
+
+    // nodes are always taken by reference, evaluating numeric expressions (like `1+2*3`) never allocates
+    public: Node evaluateNode(const Node& node);
+
+    // prints a value as the result of a prompt, lazy strings are printed page by page
+    public: void printResult(const Node& value);
+
+    private: Node evaluateIdentifier(const Node& identifier);
 
-    private: Node evaluateIdentifier(Node identifier);
+    // a lazy string reads its file only when it's accessed, so it fails once the file was written after it was read
+    private: Node expectUnchangedFile(const Node& value, Position pos);
 
-    private: Node evaluateBin(BinNode bin);
+    private: Node evaluateBin(const BinNode& bin);
+
+    // pulls the lines of the pipeline one by one and prints them
+    private: Node evaluatePipeline(const BinNode& pipe, Position pos);
+
+    // returns the stream of the lines produced by `node`, or nullptr when `failed()`
+    private: Stream* openStream(const Node& node);
+
+    // returns the pipeline stage described by the call `node`, which pulls its input from `upstream`
+    private: Stream* openStreamStage(const Node& node, Stream* upstream);
 
     private: float64 evaluateOperationNum(NodeKind op, float64 l, float64 r, Position rPos);
 
-    private: cstring_t evaluateOperationStr(Node op, cstring_t l, cstring_t r);
+    // concatenates two strings of any kind by their lengths, the result is bytes when either of them is
+    private: Node evaluateOperationStr(NodeKind op, const Node& l, const Node& r, Position opPos);
+
+    private: Node evaluateUna(const UnaNode& una);
 
-    private: Node evaluateUna(UnaNode una);
+    private: Node evaluateAssign(const AssignNode& assign, Position pos);
 
-    private: Node evaluateAssign(AssignNode assign, Position pos);
+    private: Node evaluateCall(const CallNode& call, Position pos);
 
-    private: Node evaluateCall(CallNode call, Position pos);
+    private: Node evaluateCallProcess(const CallNode& call, Position pos);
 
-    private: Node evaluateCallProcess(CallNode call, Position pos);
+    // evaluates the args in the current frame, then the body of the function in a new frame
+    private: Node evaluateCallFunction(const DefNode& function, const CallNode& call, Position pos);
 
-    private: void builtinPrint(CallNode call);
+    // stores a copy of the function (replacing the one with the same name)
+    private: Node evaluateDef(const DefNode& def, Position pos);
 
-    private: Node builtinFloor(CallNode call);
+    private: void builtinPrint(const CallNode& call);
 
-    private: void builtinCd(CallNode call);
+    private: Node builtinFloor(const CallNode& call);
 
-    private: void builtinClear(CallNode call);
+    private: void builtinCd(const CallNode& call);
 
-    private: void builtinShutdown(CallNode call);
+    private: void builtinClear(const CallNode& call);
 
-    private: void builtinLs(CallNode call);
+    private: void builtinShutdown(const CallNode& call);
 
-    private: void builtinRmDir(CallNode call);
+    private: void builtinLs(const CallNode& call);
+
+    private: void printDirEntries(const std::string& path);
+
+    private: void builtinRmDir(const CallNode& call);
     
-    private: void builtinMkDir(CallNode call);
+    private: void builtinMkDir(const CallNode& call);
     
-    private: void builtinRmFile(CallNode call);
+    private: void builtinRmFile(const CallNode& call);
+
+    private: void builtinWrite(const CallNode& call);
 
-    private: void builtinWrite(CallNode call);
+    // `read(path)` reads a string, `read(path, 'b')` reads bytes (big files are lazy either way)
+    private: Node builtinRead(const CallNode& call, Position pos);
 
-    private: Node builtinRead(CallNode call, Position pos);
+    // prints the lines matching a pattern inside a file, or inside all the files of a directory
+    private: void builtinGrep(const CallNode& call);
 
-    private: void expectArgsCount(CallNode call, uint64_t count);
+    // compresses a file in the lz77 format of the bios, the source is read in chunks
+    private: void builtinCompress(const CallNode& call);
 
-    private: std::string expectNonEmptyStringAndGetString(Node node);
+    // decompresses a file made by `compress` into another file, or into a string when there's no destination
+    private: Node builtinDecompress(const CallNode& call, Position pos);
+
+    // `crc32(path[, seed])` checksums a file while reading it, `crc32s(s[, seed])` checksums a string of any kind (bytes as well),
+    // the same for crc16 and hash, crc16 starts from 0xFFFF by default, the others from 0
+    private: Node builtinChecksum(const CallNode& call, Position pos, ChecksumKind kind, bool isString);
+
+    // feeds the content of a file to `checksum` one block at a time, returns false when it could not be read
+    private: bool checksumFile(const std::string& path, Checksum& checksum, Position pos);
+
+    // prints how the memory is used
+    private: void builtinMem(const CallNode& call);
+
+    // sets the memory budget in bytes
+    private: void builtinBudget(const CallNode& call);
+
+    // prints how long each phase of the boot took
+    private: void builtinBoot(const CallNode& call);
+
+    // sets how many pages of the lazy strings can be in memory
+    private: void builtinPageCache(const CallNode& call);
+
+    // writes the variables, the functions, the cwd and the history to a snapshot file
+    private: void builtinSave(const CallNode& call);
+
+    // replaces the variables, the functions and the cwd with the ones of a snapshot file, its history is put before the current one
+    private: void builtinLoad(const CallNode& call);
+
+    // `record(path)` records the input of the next frames into a file, `record()` stops the recording
+    private: void builtinRecord(const CallNode& call);
+
+    // replays a recording made by `record` in place of the input of the next frames
+    private: void builtinReplay(const CallNode& call);
+
+    // raises an error outside of the console, where there's no input to record
+    private: bool expectInputLog(const CallNode& call);
+
+    // raises an error while a recording is being replayed, it can't be recorded or replaced
+    private: bool expectNotReplaying(const CallNode& call);
+
+    // the snapshot path is optional for `save` and `load`
+    private: std::string expectSnapshotPath(const CallNode& call);
+
+    // returns false when the snapshot could not be written
+    private: bool saveSession(const std::string& path);
+
+    // turns a lazy string or a slice into a plain string (within the budget), or into bytes when it's binary,
+    // the other values are returned as they are
+    private: Node materialize(const Node& value);
+
+    // writes the content of a string value (lazy or not) as it is, returns false on failure
+    private: bool writeString(const Node& value, FILE* file);
+
+    // raises an error when allocating `bytes` more would exceed the memory budget
+    private: bool expectBudget(uint64_t bytes, Position pos);
+
+    // mounts the filesystem when it's not mounted yet, raises an error when it can't be mounted
+    private: bool expectFilesystem(Position pos);
+
+    // turns an allocation which used the emergency reserve into an error
+    private: Node raiseOutOfMemory(Position pos);
+
+    // the length of a string, lazy strings are not loaded
+    private: Node builtinLen(const CallNode& call, Position pos);
+
+    // `slice(s, start, end)`, negative indices count from the end, the result shares the buffer of `s`
+    private: Node builtinSlice(const CallNode& call, Position pos);
+
+    // `find(s, needle)`, the index of the first occurrence or -1
+    private: Node builtinStringFind(const CallNode& call, Position pos);
+
+    // `split(s, sep, index)` returns a field (sharing the buffer of `s`), `split(s, sep)` prints all of them
+    private: Node builtinSplit(const CallNode& call, Position pos);
+
+    // `replace(s, from, to)` replaces all the occurrences
+    private: Node builtinReplace(const CallNode& call, Position pos);
+
+    private: Node builtinChangeCase(const CallNode& call, Position pos, bool isUpper);
+
+    // removes the spaces around a string, the result shares its buffer
+    private: Node builtinTrim(const CallNode& call, Position pos);
+
+    // expects a string of any kind (bytes as well), lazy strings are loaded
+    private: StringSlice expectStringSlice(const Node& value);
+
+    private: Node makeStringSlice(const char* data, uint64_t length, Position pos);
+
+    private: Node makeBytes(const char* data, uint64_t length, Position pos);
+
+    // takes `content`, which is returned as bytes when it's binary or when it holds a null char
+    private: Node makeString(char* content, uint64_t length, bool isBinary, Position pos);
+
+    // bytes and the lazy strings read in binary mode
+    private: inline static bool isBinary(const Node& value)
+    {
+      return value.kind == NodeKind::Bytes || (value.kind == NodeKind::LazyString && value.value.lazy->isBinary);
+    }
+
+    private: inline static bool isStringKind(NodeKind kind)
+    {
+      return kind == NodeKind::String || kind == NodeKind::LazyString || kind == NodeKind::StringSlice || kind == NodeKind::Bytes;
+    }
+
+    // allocates a plain string of `length` chars (the null terminator is added), returns null when over the budget
+    private: char* allocateString(uint64_t length, Position pos);
+
+    // prints the first lines of a file, reading only them
+    private: void builtinHead(const CallNode& call);
+
+    // prints the last lines of a file, reading only them
+    private: void builtinTail(const CallNode& call);
+
+    // prints the bytes of a file range in hex, reading only them
+    private: void builtinHexdump(const CallNode& call);
+
+    // evaluates `arg` expecting a path and opens it, returns null on failure
+    private: FILE* expectFile(const Node& arg);
+
+    // copies a file or a folder with all its content
+    private: void builtinCopy(const CallNode& call);
+
+    // moves a file or a folder, across volumes it's copied and then removed
+    private: void builtinMove(const CallNode& call);
+
+    // evaluates the source and destination args, when the destination is a folder the source goes inside it
+    private: void expectSourceAndDestinationPaths(const CallNode& call, std::string& source, std::string& destination, bool& isDir);
+
+    // copies `source` to `destination`, returns the count of entries which could not be copied (they are printed)
+    private: uint64_t copyPath(const std::string& source, const std::string& destination, bool isDir);
+
+    // removes all the entries inside a folder (not the folder itself) printing the progress,
+    // returns the count of entries which could not be removed (they are printed)
+    private: uint64_t removeAllInsideDir(const std::string& path);
+
+    // walks the entries matched by the glob `pattern` (a full path) calling `action` on them, it returns true when it removed the entry,
+    // the matched folders are entered only when files are matched as well, in dry run mode the matches are printed instead,
+    // raises an error when nothing matches
+    private: void forEachGlobMatch(const std::string& pattern, Position pos, bool shouldMatchFiles, bool shouldMatchDirs, std::function<bool(cstring_t path)> action);
+
+    // sets the dry run mode
+    private: void builtinDryRun(const CallNode& call);
+
+    // the paths inside the cwd are shown relative to it
+    private: inline cstring_t getDisplayedPath(cstring_t path)
+    {
+      return strncmp(path, cwd.c_str(), cwd.length()) ? path : path + cwd.length();
+    }
+
+    // prints the paths of the files and folders below the cwd whose name matches a grep pattern
+    private: void builtinFind(const CallNode& call);
+
+    // returns the total size in bytes of the files below a folder
+    private: Node builtinDu(const CallNode& call, Position pos);
+
+    // evaluates `arg` expecting the path of an existing folder
+    private: std::string expectDirPath(const Node& arg);
+
+    // evaluates `arg` expecting a string and compiles it as a grep pattern
+    private: Grep expectGrepPattern(const Node& arg);
+
+    private: void expectArgsCount(const CallNode& call, uint64_t count);
+
+    private: cstring_t expectNonEmptyStringAndGetString(const Node& node);
+
+    // evaluates `arg` expecting a non empty string and returns it as a full path
+    private: std::string expectPath(const Node& arg, bool shouldBeFile);
 
     private: std::string getFullPath(std::string path, bool shouldBeFile);
 
-    private: Node expectType(Node node, NodeKind type);
+    private: Node expectType(const Node& node, NodeKind type);
+
+    // expects a number which is not negative
+    private: Node expectCount(const Node& node);
 
-    private: std::string expectStringLengthAndGetString(Node node, std::function<bool(uint64_t)> f);
+    private: cstring_t expectStringLengthAndGetString(const Node& node, bool (*isLengthAllowed)(uint64_t));
   };
 }
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include "regex.h"
+
+NScript::LiteralMatcher::LiteralMatcher(std::string pattern)
+{
+  this->pattern = pattern;
+
+  // by default the pattern can be moved past the compared char
+  for (auto& skip : skipTable)
+    skip = pattern.length();
+
+  // the chars inside the pattern (except the last one) align with their last occurrence
+  for (uint64_t i = 0; i + 1 < pattern.length(); i++)
+    skipTable[uint8_t(pattern[i])] = pattern.length() - 1 - i;
+}
+
+const char* NScript::LiteralMatcher::find(const char* text, uint64_t length) const
+{
+  auto patternLength = pattern.length();
+
+  if (patternLength == 0)
+    return text;
+
+  if (patternLength == 1)
+    return (const char*)memchr(text, pattern[0], length);
+
+  if (length < patternLength)
+    return nullptr;
+
+  auto last = patternLength - 1;
+
+  // comparing the last char of the window first, on mismatch the window skips ahead
+  for (uint64_t i = 0; i <= length - patternLength; i += skipTable[uint8_t(text[i + last])])
+    if (text[i + last] == pattern[last] && !memcmp(text + i, pattern.c_str(), last))
+      return text + i;
+
+  return nullptr;
+}
+
+NScript::Regex::Regex(cstring_t pattern)
+{
+  this->pattern      = pattern;
+  this->patternIndex = 0;
+  this->compileError = nullptr;
+  this->isAnchored   = pattern[0] == '^';
+
+  if (isAnchored)
+    patternIndex++;
+
+  auto fragment = compileAlternation(true);
+
+  // a `)` stopped the compilation before the end
+  if (!compileError && !eof())
+    fail("unexpected `)`");
+
+  if (compileError)
+    return;
+
+  states[fragment.end].out1 = addState(RegexStateKind::Match);
+  startState                = fragment.start;
+
+  addClosure(startClosure, startState, false);
+}
+
+int32_t NScript::Regex::addState(RegexStateKind kind, int32_t out1, int32_t out2)
+{
+  states.push_back((RegexState) { .kind = kind, .c = 0, .classIndex = 0, .out1 = out1, .out2 = out2 });
+
+  return states.size() - 1;
+}
+
+NScript::RegexFragment NScript::Regex::fail(cstring_t error)
+{
+  // only the first error is meaningful
+  if (!compileError)
+    compileError = error;
+
+  return (RegexFragment) { .start = -1, .end = -1 };
+}
+
+NScript::RegexFragment NScript::Regex::addSingleStateFragment(RegexStateKind kind)
+{
+  auto end   = addState(RegexStateKind::Epsilon);
+  auto start = addState(kind, end);
+
+  return (RegexFragment) { .start = start, .end = end };
+}
+
+NScript::RegexFragment NScript::Regex::compileAlternation(bool isTopLevel)
+{
+  auto left = compileConcatenation();
+
+  while (!compileError && pattern[patternIndex] == '|')
+  {
+    // the anchor applies to the whole search, it would anchor the other alternatives as well
+    if (isTopLevel && isAnchored)
+      return fail("`^` can't be used with `|`");
+
+    patternIndex++;
+
+    auto right = compileConcatenation();
+
+    if (compileError)
+      return right;
+
+    // both alternatives lead to the same end
+    auto end   = addState(RegexStateKind::Epsilon);
+    auto split = addState(RegexStateKind::Split, left.start, right.start);
+
+    states[left.end].out1  = end;
+    states[right.end].out1 = end;
+    left                   = (RegexFragment) { .start = split, .end = end };
+  }
+
+  return left;
+}
+
+NScript::RegexFragment NScript::Regex::compileConcatenation()
+{
+  auto start = addState(RegexStateKind::Epsilon);
+  auto end   = start;
+
+  while (!eof() && pattern[patternIndex] != '|' && pattern[patternIndex] != ')')
+  {
+    auto next = compileRepetition();
+
+    if (compileError)
+      return next;
+
+    states[end].out1 = next.start;
+    end              = next.end;
+  }
+
+  return (RegexFragment) { .start = start, .end = end };
+}
+
+NScript::RegexFragment NScript::Regex::compileRepetition()
+{
+  auto atom = compileAtom();
+
+  while (!compileError && (pattern[patternIndex] == '*' || pattern[patternIndex] == '+' || pattern[patternIndex] == '?'))
+  {
+    auto end = addState(RegexStateKind::Epsilon);
+
+    switch (pattern[patternIndex++])
+    {
+      // the atom can be skipped or repeated
+      case '*':
+      {
+        auto split = addState(RegexStateKind::Split, atom.start, end);
+
+        states[atom.end].out1 = split;
+        atom                  = (RegexFragment) { .start = split, .end = end };
+        break;
+      }
+
+      // the atom can be repeated
+      case '+':
+      {
+        auto split = addState(RegexStateKind::Split, atom.start, end);
+
+        states[atom.end].out1 = split;
+        atom.end              = end;
+        break;
+      }
+
+      // the atom can be skipped
+      default:
+      {
+        auto split = addState(RegexStateKind::Split, atom.start, end);
+
+        states[atom.end].out1 = end;
+        atom                  = (RegexFragment) { .start = split, .end = end };
+        break;
+      }
+    }
+  }
+
+  return atom;
+}
+
+NScript::RegexFragment NScript::Regex::compileAtom()
+{
+  switch (pattern[patternIndex])
+  {
+    case '(':
+    {
+      patternIndex++;
+
+      auto group = compileAlternation(false);
+
+      if (compileError)
+        return group;
+
+      if (pattern[patternIndex] != ')')
+        return fail("unclosed `(`");
+
+      patternIndex++;
+      return group;
+    }
+
+    case '*':
+    case '+':
+    case '?': return fail("nothing to repeat");
+    case '^': return fail("`^` is only supported at the start of the pattern");
+    case '[': return compileClass();
+    case '\\': return compileEscape();
+
+    case '.':
+      patternIndex++;
+      return addSingleStateFragment(RegexStateKind::Any);
+
+    case '$':
+      patternIndex++;
+      return addSingleStateFragment(RegexStateKind::LineEnd);
+
+    default:
+    {
+      auto fragment = addSingleStateFragment(RegexStateKind::Char);
+
+      states[fragment.start].c = pattern[patternIndex++];
+      return fragment;
+    }
+  }
+}
+
+NScript::RegexFragment NScript::Regex::compileClass()
+{
+  auto set = (RegexClass) { .bits = { 0 } };
+
+  // eating `[`
+  patternIndex++;
+
+  auto isNegated = pattern[patternIndex] == '^';
+
+  if (isNegated)
+    patternIndex++;
+
+  // a `]` right after the opening is part of the class
+  auto isFirstChar = true;
+
+  while (!eof() && (isFirstChar || pattern[patternIndex] != ']'))
+  {
+    auto c = uint8_t(pattern[patternIndex++]);
+
+    isFirstChar = false;
+
+    if (c == '\\' && !eof())
+    {
+      if (addShorthandClass(set, pattern[patternIndex]))
+      {
+        patternIndex++;
+        continue;
+      }
+
+      c = pattern[patternIndex++];
+    }
+
+    // a range like `a-z`, a `-` before `]` is part of the class
+    if (pattern[patternIndex] == '-' && pattern[patternIndex + 1] != ']' && pattern[patternIndex + 1] != '\0')
+    {
+      auto last = uint8_t(pattern[patternIndex + 1]);
+
+      patternIndex += 2;
+
+      for (auto i = uint64_t(c); i <= last; i++)
+        set.add(i);
+    }
+    else
+      set.add(c);
+  }
+
+  if (eof())
+    return fail("unclosed `[`");
+
+  // eating `]`
+  patternIndex++;
+
+  if (isNegated)
+    for (auto& bits : set.bits)
+      bits = ~bits;
+
+  auto fragment = addSingleStateFragment(RegexStateKind::Class);
+
+  states[fragment.start].classIndex = classes.size();
+  classes.push_back(set);
+
+  return fragment;
+}
+
+NScript::RegexFragment NScript::Regex::compileEscape()
+{
+  // eating `\`
+  patternIndex++;
+
+  if (eof())
+    return fail("pattern cannot end with `\\`");
+
+  auto c   = pattern[patternIndex++];
+  auto set = (RegexClass) { .bits = { 0 } };
+
+  if (addShorthandClass(set, c))
+  {
+    auto fragment = addSingleStateFragment(RegexStateKind::Class);
+
+    states[fragment.start].classIndex = classes.size();
+    classes.push_back(set);
+
+    return fragment;
+  }
+
+  auto fragment = addSingleStateFragment(RegexStateKind::Char);
+
+  states[fragment.start].c = c == 't' ? '\t' : c;
+  return fragment;
+}
+
+bool NScript::Regex::addShorthandClass(RegexClass& set, char c)
+{
+  switch (c)
+  {
+    case 'd':
+      for (auto i = '0'; i <= '9'; i++)
+        set.add(i);
+
+      return true;
+
+    case 'w':
+      for (auto i = 0; i < 256; i++)
+        if ((i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9') || i == '_')
+          set.add(i);
+
+      return true;
+
+    case 's':
+      set.add(' ');
+      set.add('\t');
+      set.add('\r');
+      set.add('\v');
+      set.add('\f');
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+void NScript::Regex::addClosure(std::vector<int32_t>& set, int32_t state, bool isLineEnd)
+{
+  auto position = std::lower_bound(set.begin(), set.end(), state);
+
+  // already in the set (this also stops the epsilon loops of `(a*)*`)
+  if (position != set.end() && *position == state)
+    return;
+
+  set.insert(position, state);
+
+  switch (states[state].kind)
+  {
+    case RegexStateKind::Split:
+      addClosure(set, states[state].out1, isLineEnd);
+      addClosure(set, states[state].out2, isLineEnd);
+      break;
+
+    case RegexStateKind::Epsilon:
+      addClosure(set, states[state].out1, isLineEnd);
+      break;
+
+    case RegexStateKind::LineEnd:
+      if (isLineEnd)
+        addClosure(set, states[state].out1, isLineEnd);
+
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool NScript::Regex::reachesMatchAtLineEnd(const std::vector<int32_t>& nfaStates)
+{
+  auto closure = std::vector<int32_t>();
+
+  for (const auto& state : nfaStates)
+    addClosure(closure, state, true);
+
+  for (const auto& state : closure)
+    if (states[state].kind == RegexStateKind::Match)
+      return true;
+
+  return false;
+}
+
+int32_t NScript::Regex::findOrAddDfaState(std::vector<int32_t>& nfaStates)
+{
+  for (uint64_t i = 0; i < dfa.size(); i++)
+    if (dfa[i].nfaStates == nfaStates)
+      return i;
+
+  auto state = DfaState();
+
+  state.nfaStates        = nfaStates;
+  state.isMatch          = false;
+  state.isMatchAtLineEnd = reachesMatchAtLineEnd(nfaStates);
+
+  for (auto& next : state.next)
+    next = -1;
+
+  for (const auto& s : nfaStates)
+    state.isMatch |= states[s].kind == RegexStateKind::Match;
+
+  dfa.push_back(state);
+  return dfa.size() - 1;
+}
+
+int32_t NScript::Regex::step(int32_t from, uint8_t c)
+{
+  if (dfa[from].next[c] >= 0)
+    return dfa[from].next[c];
+
+  auto next = std::vector<int32_t>();
+
+  for (const auto& s : dfa[from].nfaStates)
+  {
+    const auto& state = states[s];
+
+    if (
+      (state.kind == RegexStateKind::Char && state.c == c) ||
+      (state.kind == RegexStateKind::Any && c != '\n') ||
+      (state.kind == RegexStateKind::Class && classes[state.classIndex].contains(c))
+    )
+      addClosure(next, state.out1, false);
+  }
+
+  // an unanchored pattern can start matching at any char
+  if (!isAnchored)
+    for (const auto& s : startClosure)
+      addClosure(next, s, false);
+
+  // the cache is full, starting over from the states needed now
+  if (dfa.size() >= maxDfaStates)
+  {
+    dfa.clear();
+    findOrAddDfaState(startClosure);
+
+    return findOrAddDfaState(next);
+  }
+
+  auto to = findOrAddDfaState(next);
+
+  dfa[from].next[c] = to;
+  return to;
+}
+
+bool NScript::Regex::matchesLine(const char* line, uint64_t length)
+{
+  if (compileError)
+    return false;
+
+  // the start state is always the first one
+  auto state = dfa.empty() ? findOrAddDfaState(startClosure) : 0;
+
+  for (uint64_t i = 0; i < length && !dfa[state].isMatch; i++)
+  {
+    // an anchored pattern can fail before the end of the line
+    if (dfa[state].nfaStates.empty())
+      return false;
+
+    state = step(state, line[i]);
+  }
+
+  return dfa[state].isMatch || dfa[state].isMatchAtLineEnd;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <nds.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // skip-based search of a literal pattern (boyer-moore-horspool),
+  // single char patterns are searched with memchr
+  class LiteralMatcher
+  {
+    private: std::string pattern;
+    private: uint32_t    skipTable[256]; // how far the pattern can be moved when the last compared char is the index
+
+    public: LiteralMatcher(std::string pattern);
+
+    public: LiteralMatcher()
+    {
+      *this = LiteralMatcher("");
+    }
+
+    // returns the first occurrence of the pattern inside `text`, or nullptr
+    public: const char* find(const char* text, uint64_t length) const;
+  };
+
+  enum class RegexStateKind : uint8_t
+  {
+    Char,    // consumes `c`
+    Any,     // consumes any char
+    Class,   // consumes the chars of `classes[classIndex]`
+    Split,   // epsilon to both `out1` and `out2`
+    Epsilon, // epsilon to `out1`
+    LineEnd, // epsilon to `out1`, only at the end of the line
+    Match,
+  };
+
+  class RegexState
+  {
+    public: RegexStateKind kind;
+    public: uint8_t        c;
+    public: uint16_t       classIndex;
+    public: int32_t        out1;
+    public: int32_t        out2;
+  };
+
+  // a set of chars, one bit each
+  class RegexClass
+  {
+    public: uint32_t bits[8];
+
+    public: inline bool contains(uint8_t c) const
+    {
+      return bits[c >> 5] & (1u << (c & 31));
+    }
+
+    public: inline void add(uint8_t c)
+    {
+      bits[c >> 5] |= 1u << (c & 31);
+    }
+  };
+
+  // a piece of nfa, its end is an epsilon state which is not connected yet
+  class RegexFragment
+  {
+    public: int32_t start;
+    public: int32_t end;
+  };
+
+  // a state of the dfa, built lazily from a set of nfa states the first time it's reached
+  class DfaState
+  {
+    public: std::vector<int32_t> nfaStates;
+    public: int16_t              next[256];        // -1 when the transition is not computed yet
+    public: bool                 isMatch;          // the line matches whatever comes next
+    public: bool                 isMatchAtLineEnd; // the line matches when it ends here
+  };
+
+  // the lazily built dfa cannot grow over this count of states, then it's flushed and rebuilt
+  const uint64_t maxDfaStates = 32;
+
+  // regular expressions matched line by line, the supported syntax is:
+  //  `.` any char, `[abc]` `[a-z]` `[^abc]` classes, `\d` `\w` `\s` shorthands, `\.` escaped chars
+  //  `*` `+` `?` repetitions, `(...)` groups, `a|b` alternatives, `^` and `$` anchors
+  class Regex
+  {
+    private: std::vector<RegexState> states;
+    private: std::vector<RegexClass> classes;
+    private: std::vector<DfaState>   dfa;
+    private: int32_t                 startState;
+    private: std::vector<int32_t>    startClosure;
+    private: bool                    isAnchored;
+    private: cstring_t               pattern;
+    private: uint64_t                patternIndex;
+
+    // null when the pattern is valid
+    public: cstring_t compileError;
+
+    public: Regex(cstring_t pattern);
+
+    public: Regex()
+    {
+      *this = Regex("");
+    }
+
+    // returns true when any part of the line matches
+    public: bool matchesLine(const char* line, uint64_t length);
+
+    private: int32_t addState(RegexStateKind kind, int32_t out1 = -1, int32_t out2 = -1);
+
+    // `isTopLevel` is false inside the groups
+    private: RegexFragment compileAlternation(bool isTopLevel);
+
+    private: RegexFragment compileConcatenation();
+
+    private: RegexFragment compileRepetition();
+
+    private: RegexFragment compileAtom();
+
+    private: RegexFragment compileClass();
+
+    private: RegexFragment compileEscape();
+
+    private: RegexFragment fail(cstring_t error);
+
+    private: RegexFragment addSingleStateFragment(RegexStateKind kind);
+
+    // adds the chars of a shorthand like `\d` to `set`, returns false when `c` is not a shorthand
+    private: static bool addShorthandClass(RegexClass& set, char c);
+
+    private: inline bool eof()
+    {
+      return pattern[patternIndex] == '\0';
+    }
+
+    // adds the epsilon closure of `state` to the sorted set `set`
+    private: void addClosure(std::vector<int32_t>& set, int32_t state, bool isLineEnd);
+
+    private: int32_t findOrAddDfaState(std::vector<int32_t>& nfaStates);
+
+    private: int32_t step(int32_t from, uint8_t c);
+
+    private: bool reachesMatchAtLineEnd(const std::vector<int32_t>& nfaStates);
+  };
+}
\ No newline at end of file
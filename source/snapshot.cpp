@@ -0,0 +1,251 @@
+#include "snapshot.h"
+
+static NScript::SnapshotString reserveArenaString(uint32_t& arenaSize, uint64_t length)
+{
+  auto s = (NScript::SnapshotString) { .offset = arenaSize, .length = uint32_t(length) };
+
+  arenaSize += uint32_t(length) + 1;
+  return s;
+}
+
+static bool writeArenaString(FILE* file, const char* data, uint64_t length)
+{
+  return fwrite(data, 1, length, file) == length && fputc('\0', file) != EOF;
+}
+
+static bool isArenaStringValid(const NScript::SnapshotString& s, const char* arena, uint32_t arenaSize)
+{
+  return uint64_t(s.offset) + s.length < arenaSize && arena[s.offset + s.length] == '\0';
+}
+
+// returns false for the values which can't outlive the session (such as the streams), `data` is null when the value has no string
+static bool getSavedString(const NScript::Node& value, const char*& data, uint64_t& length)
+{
+  data   = nullptr;
+  length = 0;
+
+  switch (value.kind)
+  {
+    case NScript::NodeKind::Num:
+    case NScript::NodeKind::None:
+      return true;
+
+    case NScript::NodeKind::String:
+      data   = value.value.str;
+      length = strlen(data);
+      return true;
+
+    case NScript::NodeKind::StringSlice:
+    case NScript::NodeKind::Bytes:
+      data   = value.value.slice->data;
+      length = value.value.slice->length;
+      return true;
+
+    // only the path of a lazy string is saved, the file is loaded again when it's accessed
+    case NScript::NodeKind::LazyString:
+      data   = value.value.lazy->path.c_str();
+      length = value.value.lazy->path.length();
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool NScript::writeSnapshot(
+  FILE* file, const std::string& cwd, const std::vector<KeyPair<std::string, Node>>& variables,
+  const std::vector<KeyPair<std::string, Node>>& functions, const std::vector<std::string*>& history
+)
+{
+  auto        header    = SnapshotHeader();
+  uint32_t    arenaSize = 0;
+  const char* data      = nullptr;
+  uint64_t    length    = 0;
+
+  header.magic          = snapshotMagic;
+  header.version        = snapshotVersion;
+  header.variablesCount = 0;
+  header.functionsCount = 0;
+  header.historyCount   = 0;
+  header.arenaSize      = 0;
+  header.cwd            = reserveArenaString(arenaSize, cwd.length());
+
+  // the header is written again once the counts are known, the snapshot is never built in memory
+  if (fwrite(&header, sizeof(header), 1, file) != 1)
+    return false;
+
+  for (const auto& v : variables)
+  {
+    if (!getSavedString(v.val, data, length))
+      continue;
+
+    auto record = SnapshotVariable();
+    auto isLazy = v.val.kind == NodeKind::LazyString;
+
+    record.kind         = uint32_t(v.val.kind);
+    record.num          = v.val.kind == NodeKind::Num ? v.val.value.num : 0;
+    record.size         = isLazy ? v.val.value.lazy->size : 0;
+    record.modifiedTime = isLazy ? int64_t(v.val.value.lazy->modifiedTime) : 0;
+    record.flags        = isLazy && v.val.value.lazy->isBinary ? snapshotBinaryFlag : 0;
+    record.name         = reserveArenaString(arenaSize, v.key.length());
+    record.str          = data != nullptr ? reserveArenaString(arenaSize, length) : (SnapshotString) { .offset = 0, .length = 0 };
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1)
+      return false;
+
+    header.variablesCount++;
+  }
+
+  for (const auto& f : functions)
+  {
+    auto record = reserveArenaString(arenaSize, f.val.value.def->source.length());
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1)
+      return false;
+
+    header.functionsCount++;
+  }
+
+  for (const auto& prompt : history)
+  {
+    if (prompt->empty())
+      continue;
+
+    auto record = reserveArenaString(arenaSize, prompt->length());
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1)
+      return false;
+
+    header.historyCount++;
+  }
+
+  header.arenaSize = arenaSize;
+
+  if (fseek(file, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, file) != 1 || fseek(file, 0, SEEK_END))
+    return false;
+
+  // the strings are written in the same order their offsets were assigned
+  if (!writeArenaString(file, cwd.c_str(), cwd.length()))
+    return false;
+
+  for (const auto& v : variables)
+  {
+    if (!getSavedString(v.val, data, length))
+      continue;
+
+    if (!writeArenaString(file, v.key.c_str(), v.key.length()) || (data != nullptr && !writeArenaString(file, data, length)))
+      return false;
+  }
+
+  for (const auto& f : functions)
+    if (!writeArenaString(file, f.val.value.def->source.c_str(), f.val.value.def->source.length()))
+      return false;
+
+  for (const auto& prompt : history)
+    if (!prompt->empty() && !writeArenaString(file, prompt->c_str(), prompt->length()))
+      return false;
+
+  return true;
+}
+
+bool NScript::readSnapshot(const char* buffer, uint64_t size, Snapshot& snapshot)
+{
+  if (size < sizeof(SnapshotHeader))
+    return false;
+
+  const auto& header = *(const SnapshotHeader*)buffer;
+
+  if (header.magic != snapshotMagic || header.version != snapshotVersion)
+    return false;
+
+  auto recordsSize =
+    uint64_t(header.variablesCount) * sizeof(SnapshotVariable) +
+    (uint64_t(header.functionsCount) + header.historyCount) * sizeof(SnapshotString);
+
+  if (sizeof(SnapshotHeader) + recordsSize + header.arenaSize != size)
+    return false;
+
+  auto variables = (const SnapshotVariable*)(buffer + sizeof(SnapshotHeader));
+  auto functions = (const SnapshotString*)(variables + header.variablesCount);
+  auto history   = functions + header.functionsCount;
+  auto arena     = (const char*)(history + header.historyCount);
+
+  if (!isArenaStringValid(header.cwd, arena, header.arenaSize))
+    return false;
+
+  snapshot.cwd = std::string(arena + header.cwd.offset, header.cwd.length);
+  snapshot.variables.reserve(header.variablesCount);
+  snapshot.functions.reserve(header.functionsCount);
+  snapshot.history.reserve(header.historyCount);
+
+  for (uint32_t i = 0; i < header.variablesCount; i++)
+  {
+    const auto& record = variables[i];
+    auto        value  = Node::none(Position());
+
+    if (!isArenaStringValid(record.name, arena, header.arenaSize))
+      return false;
+
+    switch (NodeKind(record.kind))
+    {
+      case NodeKind::Num:
+        value = Node(NodeKind::Num, (NodeValue) { .num = record.num }, Position());
+        break;
+
+      case NodeKind::None:
+        break;
+
+      // the strings are used right from the arena, they are never copied
+      case NodeKind::String:
+        if (!isArenaStringValid(record.str, arena, header.arenaSize))
+          return false;
+
+        value = Node(NodeKind::String, (NodeValue) { .str = arena + record.str.offset }, Position());
+        break;
+
+      // the slices keep their length, they may hold null chars
+      case NodeKind::StringSlice:
+      case NodeKind::Bytes:
+        if (!isArenaStringValid(record.str, arena, header.arenaSize))
+          return false;
+
+        value = Node(NodeKind(record.kind), (NodeValue) { .slice = new StringSlice(arena + record.str.offset, record.str.length) }, Position());
+        break;
+
+      case NodeKind::LazyString:
+        if (!isArenaStringValid(record.str, arena, header.arenaSize))
+          return false;
+
+        // the file keeps the time it had when it was read, so that it's found changed if it was written since then
+        value = Node(
+          NodeKind::LazyString,
+          (NodeValue) { .lazy = new LazyFile(std::string(arena + record.str.offset, record.str.length), record.size, record.flags & snapshotBinaryFlag, time_t(record.modifiedTime)) },
+          Position()
+        );
+        break;
+
+      default:
+        return false;
+    }
+
+    snapshot.variables.push_back(KeyPair<std::string, Node>(std::string(arena + record.name.offset, record.name.length), value));
+  }
+
+  for (uint32_t i = 0; i < header.functionsCount; i++)
+  {
+    if (!isArenaStringValid(functions[i], arena, header.arenaSize))
+      return false;
+
+    snapshot.functions.push_back(std::string(arena + functions[i].offset, functions[i].length));
+  }
+
+  for (uint32_t i = 0; i < header.historyCount; i++)
+  {
+    if (!isArenaStringValid(history[i], arena, header.arenaSize))
+      return false;
+
+    snapshot.history.push_back(std::string(arena + history[i].offset, history[i].length));
+  }
+
+  return true;
+}
\ No newline at end of file
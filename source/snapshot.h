@@ -0,0 +1,72 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+#include <c++/12.1.0/vector>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+#include "nscript.h"
+
+namespace NScript
+{
+  // `save()` and `load()` use this file when no path is given, `shutdown()` always saves to it
+  const cstring_t defaultSnapshotPath = "/session.nss";
+
+  // "NSS1" read as a little endian word
+  const uint32_t snapshotMagic   = 0x3153534E;
+  const uint32_t snapshotVersion = 2;
+
+  // set in the flags of a lazy string read in binary mode
+  const uint32_t snapshotBinaryFlag = 1;
+
+  // a string inside the arena at the end of the snapshot, it's followed by a null char which is not counted in `length`
+  class SnapshotString
+  {
+    public: uint32_t offset;
+    public: uint32_t length;
+  };
+
+  class SnapshotHeader
+  {
+    public: uint32_t       magic;
+    public: uint32_t       version;
+    public: uint32_t       variablesCount;
+    public: uint32_t       functionsCount;
+    public: uint32_t       historyCount;
+    public: uint32_t       arenaSize;
+    public: SnapshotString cwd;
+  };
+
+  // the records have a fixed size, so that they are used right from the loaded buffer
+  class SnapshotVariable
+  {
+    public: SnapshotString name;
+    public: SnapshotString str;          // the content of a string (or bytes), or the path of a lazy string
+    public: float64        num;
+    public: uint64_t       size;         // the size of the file of a lazy string
+    public: int64_t        modifiedTime; // the time of the file of a lazy string when it was read
+    public: uint32_t       kind;
+    public: uint32_t       flags;
+  };
+
+  // the snapshot is laid out as: header, variables, functions, history, arena (all the fields are little endian, as the ds is),
+  // the functions are saved as the text of their defs
+  class Snapshot
+  {
+    public: std::string                             cwd;
+    public: std::vector<KeyPair<std::string, Node>> variables; // the strings point inside the loaded buffer
+    public: std::vector<std::string>                functions; // the defs, to be parsed and evaluated again
+    public: std::vector<std::string>                history;
+  };
+
+  // writes the session sequentially, returns false when the file could not be written
+  bool writeSnapshot(
+    FILE* file, const std::string& cwd, const std::vector<KeyPair<std::string, Node>>& variables,
+    const std::vector<KeyPair<std::string, Node>>& functions, const std::vector<std::string*>& history
+  );
+
+  // reads the session from the whole content of a snapshot file, the buffer must outlive the loaded strings,
+  // returns false when the snapshot is corrupted or made by another version
+  bool readSnapshot(const char* buffer, uint64_t size, Snapshot& snapshot);
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "stream.h"
+
+bool NScript::FileLinesStream::nextLine(char* line)
+{
+  if (!fgets(line, streamLineSize, file))
+    return false;
+
+  auto length = strlen(line);
+
+  // removing the line terminator (`\n` or `\r\n`), a chunk of a longer line has none
+  if (length > 0 && line[length - 1] == '\n')
+    line[--length] = '\0';
+
+  if (length > 0 && line[length - 1] == '\r')
+    line[--length] = '\0';
+
+  return true;
+}
+
+bool NScript::StringLinesStream::nextLine(char* line)
+{
+  if (*next == '\0')
+    return false;
+
+  uint64_t length = 0;
+
+  // copying until the end of the line or until the buffer is full
+  while (next[length] != '\0' && next[length] != '\n' && length < streamLineSize - 1)
+  {
+    line[length] = next[length];
+    length++;
+  }
+
+  line[length] = '\0';
+  next        += length;
+
+  // skipping the line terminator
+  if (*next == '\n')
+    next++;
+
+  return true;
+}
+
+bool NScript::LazyLinesStream::nextLine(char* line)
+{
+  // reading as much as a line can hold, then cutting it at its terminator
+  auto length = pageCache.read(file, offset, streamLineSize - 1, line);
+
+  if (length == 0)
+    return false;
+
+  auto terminator = (char*)memchr(line, '\n', length);
+
+  if (terminator)
+    length = terminator - line;
+
+  offset += length + (terminator ? 1 : 0);
+
+  if (length > 0 && line[length - 1] == '\r')
+    length--;
+
+  line[length] = '\0';
+  return true;
+}
+
+bool NScript::SplitStream::nextLine(char* line)
+{
+  if (isOver)
+    return false;
+
+  auto fieldEnd    = separator.find(next, end - next);
+  auto fieldLength = uint64_t((fieldEnd ? fieldEnd : end) - next);
+  auto length      = std::min(fieldLength, streamLineSize - 1);
+
+  memcpy(line, next, length);
+  line[length] = '\0';
+
+  // a field longer than a line is split in chunks, the next one continues it
+  if (length < fieldLength)
+    next += length;
+  else if (fieldEnd)
+    next = fieldEnd + separatorLength;
+  else
+    isOver = true;
+
+  return true;
+}
+
+bool NScript::DirEntriesStream::nextLine(char* line)
+{
+  auto entry = dir ? readdir(dir) : nullptr;
+
+  if (!entry)
+    return false;
+
+  auto type =
+    // not all file systems support dirent.d_type, when possible prints:
+    //  `file`   -> for regular files
+    //  `folder` -> for directories
+    //  `other`  -> for other elment's types (see https://ftp.gnu.org/old-gnu/Manuals/glibc-2.2.5/html_node/Directory-Entries.html)
+    //  `?`      -> for unknown elements (they could be files, folders or other)
+    entry->d_type == DT_REG ? "file" : entry->d_type == DT_DIR ? "folder" : entry->d_type == DT_UNKNOWN ? "?" : "other";
+
+  // the name is truncated so that ` (type)` always fits in the line
+  auto maxNameLength = int(streamLineSize - strlen(" ()") - strlen(type) - 1);
+
+  snprintf(line, streamLineSize, "%.*s (%s)", maxNameLength, entry->d_name, type);
+
+  return true;
+}
+
+bool NScript::FilterStream::nextLine(char* line)
+{
+  while (upstream->nextLine(line))
+    if (strstr(line, pattern))
+      return true;
+
+  return false;
+}
+
+bool NScript::GrepStream::nextLine(char* line)
+{
+  while (upstream->nextLine(line))
+    if (grep.matchesLine(line, strlen(line)))
+      return true;
+
+  return false;
+}
+
+bool NScript::HeadStream::nextLine(char* line)
+{
+  if (remainingLines == 0)
+    return false;
+
+  remainingLines--;
+  return upstream->nextLine(line);
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <nds.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <c++/12.1.0/string>
+
+#include "basics.h"
+#include "nscript.h"
+#include "grep.h"
+#include "lazy.h"
+
+namespace NScript
+{
+  // lines flowing through a pipeline are at most this long (null terminator included), longer ones are split in chunks
+  const uint64_t streamLineSize = 256;
+
+  // a stage of a pipeline, lines are pulled lazily from the last stage, which pulls them from the previous one and so on
+  class Stream
+  {
+    public: virtual ~Stream()
+    {
+    }
+
+    // writes the next line into `line` (null terminated and without `\n`), returns false when the stream is over
+    public: virtual bool nextLine(char* line) = 0;
+  };
+
+  // the lines of a file, read through the small buffer of the FILE
+  class FileLinesStream : public Stream
+  {
+    private: FILE* file;
+
+    public: FileLinesStream(FILE* file)
+    {
+      this->file = file;
+    }
+
+    public: ~FileLinesStream()
+    {
+      fclose(file);
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the lines of a string value
+  class StringLinesStream : public Stream
+  {
+    private: cstring_t next;
+
+    public: StringLinesStream(cstring_t s)
+    {
+      this->next = s;
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the lines of a lazy string, loaded through the page cache
+  class LazyLinesStream : public Stream
+  {
+    private: LazyPageCache& pageCache;
+    private: const LazyFile& file;
+    private: uint64_t        offset;
+
+    public: LazyLinesStream(LazyPageCache& pageCache, const LazyFile& file) : pageCache(pageCache), file(file)
+    {
+      this->offset = 0;
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the fields of a string, separated by a non empty separator
+  class SplitStream : public Stream
+  {
+    private: const char*    next;
+    private: const char*    end;
+    private: LiteralMatcher separator;
+    private: uint64_t       separatorLength;
+    private: bool           isOver;
+
+    public: SplitStream(StringSlice s, StringSlice separator)
+    {
+      this->next            = s.data;
+      this->end             = s.data + s.length;
+      this->separator       = LiteralMatcher(std::string(separator.data, separator.length));
+      this->separatorLength = separator.length;
+      this->isOver          = false;
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // one line for each entry of a directory, formatted as `name (type)`
+  class DirEntriesStream : public Stream
+  {
+    private: DIR* dir;
+
+    // the directory may be null when it could not be opened (the stream is empty)
+    public: DirEntriesStream(DIR* dir)
+    {
+      this->dir = dir;
+    }
+
+    public: ~DirEntriesStream()
+    {
+      if (dir)
+        closedir(dir);
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the lines of the upstream which contain a pattern
+  class FilterStream : public Stream
+  {
+    private: Stream*   upstream;
+    private: cstring_t pattern;
+
+    public: FilterStream(Stream* upstream, cstring_t pattern)
+    {
+      this->upstream = upstream;
+      this->pattern  = pattern;
+    }
+
+    public: ~FilterStream()
+    {
+      delete upstream;
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the lines of the upstream which match a grep pattern
+  class GrepStream : public Stream
+  {
+    private: Stream* upstream;
+    private: Grep    grep;
+
+    public: GrepStream(Stream* upstream, Grep grep) : grep(grep)
+    {
+      this->upstream = upstream;
+    }
+
+    public: ~GrepStream()
+    {
+      delete upstream;
+    }
+
+    public: bool nextLine(char* line);
+  };
+
+  // the first lines of the upstream, once they are pulled the upstream is not read anymore
+  class HeadStream : public Stream
+  {
+    private: Stream*  upstream;
+    private: uint64_t remainingLines;
+
+    public: HeadStream(Stream* upstream, uint64_t count)
+    {
+      this->upstream       = upstream;
+      this->remainingLines = count;
+    }
+
+    public: ~HeadStream()
+    {
+      delete upstream;
+    }
+
+    public: bool nextLine(char* line);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "walker.h"
+
+NScript::DirWalker::DirWalker(cstring_t root)
+{
+  this->openDirs = 0;
+  this->event    = WalkEvent::File;
+
+  auto length = strlen(root);
+
+  if (length >= walkerPathSize)
+  {
+    // nothing is walked
+    this->path[0] = '\0';
+    return;
+  }
+
+  memcpy(this->path, root, length + 1);
+  this->stack.push_back((WalkerFrame) { .dir = nullptr, .entriesRead = 0, .pathLength = length });
+}
+
+NScript::DirWalker::~DirWalker()
+{
+  for (const auto& frame : stack)
+    if (frame.dir)
+      closedir(frame.dir);
+}
+
+cstring_t NScript::DirWalker::getName()
+{
+  return path + stack[getDepth()].pathLength;
+}
+
+void NScript::DirWalker::entryRemoved()
+{
+  stack[getDepth()].entriesRead--;
+}
+
+void NScript::DirWalker::closeOutermostDir()
+{
+  for (auto& frame : stack)
+    if (frame.dir)
+    {
+      closedir(frame.dir);
+      frame.dir = nullptr;
+      openDirs--;
+      return;
+    }
+}
+
+bool NScript::DirWalker::openTopDir()
+{
+  auto& top = stack.back();
+
+  if (openDirs >= maxWalkerOpenDirs)
+    closeOutermostDir();
+
+  path[top.pathLength] = '\0';
+  top.dir              = opendir(path);
+
+  if (!top.dir)
+    return false;
+
+  openDirs++;
+
+  // a reopened directory continues from where it was left
+  for (uint64_t i = 0; i < top.entriesRead; i++)
+    readdir(top.dir);
+
+  return true;
+}
+
+bool NScript::DirWalker::next()
+{
+  while (!stack.empty())
+  {
+    if (!stack.back().dir && !openTopDir())
+    {
+      // the directory is not visited, the path is left pointing to it
+      stack.pop_back();
+
+      // the root is not an entry
+      if (stack.empty())
+        return false;
+
+      event = WalkEvent::Error;
+      return true;
+    }
+
+    auto& top   = stack.back();
+    auto  entry = readdir(top.dir);
+
+    if (!entry)
+    {
+      closedir(top.dir);
+      openDirs--;
+
+      path[top.pathLength] = '\0';
+      stack.pop_back();
+
+      if (stack.empty())
+        return false;
+
+      event = WalkEvent::LeaveDir;
+      return true;
+    }
+
+    top.entriesRead++;
+
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+      continue;
+
+    // writing the entry's path over the previous one
+    auto isDir        = entry->d_type == DT_DIR;
+    auto nameLength   = strlen(entry->d_name);
+    auto pathLength   = top.pathLength + nameLength + (isDir ? 1 : 0);
+
+    if (pathLength >= walkerPathSize)
+    {
+      // the path is left pointing to the parent directory
+      path[top.pathLength] = '\0';
+      event                = WalkEvent::Error;
+      return true;
+    }
+
+    memcpy(path + top.pathLength, entry->d_name, nameLength);
+    path[top.pathLength + nameLength] = '/';
+    path[pathLength]                  = '\0';
+
+    if (!isDir)
+    {
+      event = WalkEvent::File;
+      return true;
+    }
+
+    // the sub directory is opened by the next call
+    stack.push_back((WalkerFrame) { .dir = nullptr, .entriesRead = 0, .pathLength = pathLength });
+    event = WalkEvent::EnterDir;
+    return true;
+  }
+
+  return false;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <nds.h>
+#include <dirent.h>
+#include <c++/12.1.0/vector>
+
+#include "basics.h"
+
+namespace NScript
+{
+  // the longest path the walker can build (null terminator included), deeper entries are reported as errors
+  const uint64_t walkerPathSize = 768;
+
+  // the walker never keeps more than these directories open at the same time (the fat driver has few handles),
+  // the outer ones are closed and later reopened where they were left
+  const uint64_t maxWalkerOpenDirs = 4;
+
+  enum class WalkEvent : uint8_t
+  {
+    File,     // a file (or any other non directory entry)
+    EnterDir, // a sub directory, its entries come next
+    LeaveDir, // all the entries of the sub directory were visited, it can be removed now
+    Error,    // a directory could not be opened or a path was too long, it's not visited
+  };
+
+  // a directory being walked
+  class WalkerFrame
+  {
+    public: DIR*     dir;          // null when closed to spare handles (or not opened yet)
+    public: uint64_t entriesRead;  // how many entries to skip when the directory is reopened
+    public: uint64_t pathLength;   // length of the directory's path inside the path buffer (trailing `/` included)
+  };
+
+  // visits all the entries below a directory, depth first and without recursion,
+  // the paths are built into a single buffer which is reused for the whole walk:
+  //  `auto walker = DirWalker("/dir/"); while (walker.next()) iprintf("%s\n", walker.getPath());`
+  class DirWalker
+  {
+    private: std::vector<WalkerFrame> stack;
+    private: char                     path[walkerPathSize];
+    private: uint64_t                 openDirs;
+
+    // what the last entry returned by `next` is
+    public: WalkEvent event;
+
+    // `root` must end with `/`, it's not reported itself
+    public: DirWalker(cstring_t root);
+
+    public: ~DirWalker();
+
+    // moves to the next entry, returns false when the walk is over
+    public: bool next();
+
+    // the full path of the current entry (directories end with `/`), valid until the next call to `next`
+    public: inline cstring_t getPath()
+    {
+      return path;
+    }
+
+    // the name of the current entry inside the path
+    public: cstring_t getName();
+
+    // how deep the current entry is, the entries of the root are at depth 0
+    public: inline uint64_t getDepth()
+    {
+      return event == WalkEvent::EnterDir ? stack.size() - 2 : stack.size() - 1;
+    }
+
+    // tells the walker that the current entry was removed, so that its parent is reopened at the right entry
+    public: void entryRemoved();
+
+    // the entries of the directory just entered are not visited (and no LeaveDir is reported for it),
+    // it must be called after `entryRemoved`
+    public: inline void skipDir()
+    {
+      stack.pop_back();
+    }
+
+    private: bool openTopDir();
+
+    private: void closeOutermostDir();
+  };
+}
\ No newline at end of file